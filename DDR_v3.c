@@ -4,7 +4,16 @@
 #include <string.h>
 #include "pico/stdlib.h"
 #include "hardware/i2c.h"
+#include "hardware/sync.h"
+#include "hardware/pwm.h"
+#include "hardware/dma.h"
+#include "hardware/clocks.h"
 #include "pico/binary_info.h"
+#include "replay.h"
+#include "trace.h"
+#define CHART_RAND() replay_rand()
+#include "ddr_chart.h"
+#include "charts/demo.h"
 
 // LCD command definitions
 const int LCD_CLEARDISPLAY = 0x01;
@@ -57,8 +66,12 @@ static int addr = 0x27;
 
 // Basic timing and gameplay constants (adjusted for half speed)
 #define HIT_ZONE_POS      0      // leftmost column is our hit zone
-#define SCROLL_DELAY_MS   300    // delay between each scroll update
-#define HIT_WINDOW_MS     400    // timing window in ms
+#define SCROLL_DELAY_MS   20     // delay between scroll / judge passes
+#define HIT_WINDOW_MS     400    // timing window in ms, either side of the beat
+#define FEEDBACK_MS       500    // how long a judgement stays on line 1
+#define HOLD_GRACE_MS     150    // a hold may be let go this early
+#define CELL_MS           200    // scroll speed: time per LCD column
+#define LOOKAHEAD_MS      (MAX_CHARS * CELL_MS)  // chart queued ahead of now
 
 // Difficulty settings: these values will adjust as rounds progress.
 uint32_t base_delay_ms = 2000;   // initial arrow delay (ms)
@@ -69,12 +82,20 @@ int sequence_length = 5;         // number of arrows per round
 typedef struct {
     int arrow;                 // 0=LEFT, 1=UP, 2=RIGHT, 3=DOWN
     absolute_time_t hit_time;  // Scheduled time to hit
-    bool hit;                  // Whether the arrow has been hit
+    uint32_t hold_ms;          // 0 for a tap
 } ArrowCommand;
 
-#define MAX_ARROWS 10
-ArrowCommand arrows[MAX_ARROWS];
-int arrow_count = 0;
+// One FIFO of upcoming arrows per lane, soonest at head. Arrows are
+// scheduled in time order, so a press only ever has to look at the head of
+// its own lane, and an arrow leaves its lane by advancing head.
+#define LANE_QUEUE_LEN 16      // per lane, power of two
+typedef struct {
+    ArrowCommand notes[LANE_QUEUE_LEN];
+    uint32_t head, tail;
+} LaneQueue;
+LaneQueue lanes_q[4];
+bool holding[4];               // lane is in a hold that was hit
+absolute_time_t hold_end[4];
 
 // Global score and combo variables.
 int score = 0;
@@ -82,60 +103,148 @@ int combo = 0;
 
 // ---------- LCD Functions ----------
 
-// Write a single byte over I2C.
-void i2c_write_byte(uint8_t val) {
+// Packed PCF8574 transport. Each I2C data byte is one port write; a nibble
+// is (nibble|E) then (nibble), latched on E's falling edge, with a leading
+// E-low write only when RS changes so it settles before E rises. Port
+// writes queue up in lcd_q and go out in one i2c_write_blocking() per
+// lcd_commit(). From one instruction's last E fall to the next one's first
+// (its high nibble latching) is 2 I2C byte times, 3 if RS changes; that
+// must cover the 37 us a character or ordinary command takes. Clear/home
+// take 1.52 ms, so they end the transaction and the next commit waits them
+// out.
+#define LCD_I2C_HZ        (400 * 1000)
+#define LCD_EXEC_US       37
+#define LCD_EXEC_LONG_US  1520
+#define LCD_Q_MAX         64
+
+_Static_assert(2 * 9 * 1000000 / LCD_I2C_HZ >= LCD_EXEC_US,
+               "I2C clock too fast for back-to-back LCD instructions");
+
+static uint8_t lcd_q[LCD_Q_MAX];
+static int lcd_qn;
+static uint8_t lcd_port = LCD_BACKLIGHT;   // last value on the PCF8574 pins
+static absolute_time_t lcd_ready;          // LCD done executing by then
+
+// Send everything queued in one I2C transaction.
+void lcd_commit(void) {
+    if (lcd_qn == 0) return;
 #ifdef i2c_default
-    i2c_write_blocking(i2c_default, addr, &val, 1, false);
+    sleep_until(lcd_ready);
+    i2c_write_blocking(i2c_default, addr, lcd_q, lcd_qn, false);
+    trace_add(TC_I2C_BYTES, lcd_qn + 1);    // address + data
+    trace_add(TC_I2C_XFERS, 1);
 #endif
+    lcd_qn = 0;
+    lcd_ready = make_timeout_time_us(LCD_EXEC_US);
+}
+
+static void lcd_nibble(uint8_t nib) {
+    if ((nib ^ lcd_port) & LCD_CHARACTER) lcd_q[lcd_qn++] = nib;
+    lcd_q[lcd_qn++] = nib | LCD_ENABLE_BIT;
+    lcd_q[lcd_qn++] = nib;
+    lcd_port = nib;
 }
 
-// Increase delay to allow the LCD to latch data properly.
-void lcd_toggle_enable(uint8_t val) {
-    #define DELAY_US 500
-    sleep_us(DELAY_US);
-    i2c_write_byte(val | LCD_ENABLE_BIT);
-    sleep_us(DELAY_US);
-    i2c_write_byte(val & ~LCD_ENABLE_BIT);
-    sleep_us(DELAY_US);
+// Queue one instruction or character; clear/home are sent right away.
+void lcd_queue(uint8_t val, int mode) {
+    if (lcd_qn > LCD_Q_MAX - 6) lcd_commit();
+    lcd_nibble(mode | (val & 0xF0) | LCD_BACKLIGHT);
+    lcd_nibble(mode | ((val << 4) & 0xF0) | LCD_BACKLIGHT);
+    if (mode == LCD_COMMAND && val != 0 && val < LCD_ENTRYMODESET) {
+        lcd_commit();
+        lcd_ready = make_timeout_time_us(LCD_EXEC_LONG_US);
+    }
 }
 
 void lcd_send_byte(uint8_t val, int mode) {
-    uint8_t high = mode | (val & 0xF0) | LCD_BACKLIGHT;
-    uint8_t low  = mode | ((val << 4) & 0xF0) | LCD_BACKLIGHT;
-    i2c_write_byte(high);
-    lcd_toggle_enable(high);
-    i2c_write_byte(low);
-    lcd_toggle_enable(low);
+    lcd_queue(val, mode);
+    lcd_commit();
 }
 
+// What the LCD holds, kept in step by the primitives below, and the DDRAM
+// address the next character lands on (-1 = unknown).
+static char lcd_shown[MAX_LINES][MAX_CHARS];
+static int  lcd_addr = -1;
+
+// These queue; lcd_string(), lcd_flush() and friends commit.
 void lcd_clear(void) {
-    lcd_send_byte(LCD_CLEARDISPLAY, LCD_COMMAND);
+    lcd_queue(LCD_CLEARDISPLAY, LCD_COMMAND);
+    memset(lcd_shown, ' ', sizeof(lcd_shown));
+    lcd_addr = 0;
 }
 
 void lcd_set_cursor(int line, int position) {
     int val = (line == 0) ? 0x80 + position : 0xC0 + position;
-    lcd_send_byte(val, LCD_COMMAND);
+    lcd_queue(val, LCD_COMMAND);
+    lcd_addr = val & 0x7F;
 }
 
 static inline void lcd_char(char val) {
-    lcd_send_byte(val, LCD_CHARACTER);
+    lcd_queue(val, LCD_CHARACTER);
+    if (lcd_addr < 0) return;
+    int line = lcd_addr >> 6, pos = lcd_addr & 0x3F;   // line 1 starts at 0x40
+    if (line < MAX_LINES && pos < MAX_CHARS) lcd_shown[line][pos] = val;
+    lcd_addr++;
 }
 
 void lcd_string(const char *s) {
     while (*s) {
         lcd_char(*s++);
     }
+    lcd_commit();
+}
+
+// ---------- Shadow DDRAM ----------
+// Screens are drawn into lcd_buf; lcd_flush() sends only the cells that
+// differ from lcd_shown, with a cursor move only where the address counter
+// isn't already on the next changed cell. No clear, so no flicker.
+static char lcd_buf[MAX_LINES][MAX_CHARS];
+
+void lcd_buf_clear(void) {
+    memset(lcd_buf, ' ', sizeof(lcd_buf));
+}
+
+// Write s at (line, position) in the shadow, clipped to the line.
+void lcd_put(int line, int position, const char *s) {
+    while (*s && position < MAX_CHARS) {
+        lcd_buf[line][position++] = *s++;
+    }
+}
+
+void lcd_flush(void) {
+    // Going to a blank screen: one clear beats blanking cell by cell, and
+    // there is nothing left on it to flicker.
+    int changed = 0, blank = 1;
+    for (int line = 0; line < MAX_LINES; line++) {
+        for (int pos = 0; pos < MAX_CHARS; pos++) {
+            changed += lcd_buf[line][pos] != lcd_shown[line][pos];
+            blank &= lcd_buf[line][pos] == ' ';
+        }
+    }
+    if (blank && changed > 1) {
+        lcd_clear();
+        return;
+    }
+    for (int line = 0; line < MAX_LINES; line++) {
+        for (int pos = 0; pos < MAX_CHARS; pos++) {
+            if (lcd_buf[line][pos] == lcd_shown[line][pos]) continue;
+            if (lcd_addr != line * 0x40 + pos) lcd_set_cursor(line, pos);
+            lcd_char(lcd_buf[line][pos]);
+        }
+    }
+    lcd_commit();
 }
 
 // ---------- Custom Character Functions ----------
 // Create a custom character (location 0 to 7) from an 8-byte bitmap.
 void lcd_create_custom_char(uint8_t location, uint8_t charmap[]) {
-    lcd_send_byte(LCD_SETCGRAMADDR | (location << 3), LCD_COMMAND);
+    lcd_queue(LCD_SETCGRAMADDR | (location << 3), LCD_COMMAND);
     for (int i = 0; i < 8; i++) {
-        lcd_send_byte(charmap[i], LCD_CHARACTER);
+        lcd_queue(charmap[i], LCD_CHARACTER);
     }
     // Return to DDRAM.
-    lcd_send_byte(LCD_SETDDRAMADDR, LCD_COMMAND);
+    lcd_set_cursor(0, 0);
+    lcd_commit();
 }
 
 // Define custom arrow bitmaps.
@@ -186,7 +295,10 @@ uint8_t arrow_down[8] = {
 // ---------- Updated LCD Initialization ----------
 // Initialize LCD and load custom arrow characters.
 void lcd_init_custom() {
+    // Reset to 8-bit, then 4-bit: >4.1 ms after the first function set,
+    // >100 us after the second (each 0x03 here is 0x00, 0x30 in 8-bit mode).
     lcd_send_byte(0x03, LCD_COMMAND);
+    sleep_us(4100);
     lcd_send_byte(0x03, LCD_COMMAND);
     lcd_send_byte(0x03, LCD_COMMAND);
     lcd_send_byte(0x02, LCD_COMMAND);
@@ -203,85 +315,364 @@ void lcd_init_custom() {
 }
 
 // ---------- Button Functions ----------
-void buttons_init() {
-    gpio_init(BUTTON_LEFT_PIN);
-    gpio_set_dir(BUTTON_LEFT_PIN, GPIO_IN);
-    gpio_pull_up(BUTTON_LEFT_PIN);
+// Edge IRQs on the four lanes push timestamped events into a ring that the
+// game drains. Each lane debounces on its own: the first edge is taken at
+// once (so its timestamp is the real press time), edges in the following
+// DEBOUNCE_US are contact chatter, and an alarm then re-reads the pin in
+// case it settled the other way. Lanes never block each other, so a jump
+// (two arrows at once) arrives as two events.
+#define DEBOUNCE_US     5000
+#define BTN_QUEUE_LEN   32               // power of two
+
+typedef struct {
+    uint8_t lane;              // 0=LEFT, 1=UP, 2=RIGHT, 3=DOWN, as in ArrowCommand
+    bool down;                 // press, or release
+    absolute_time_t t;         // when the edge happened
+} ButtonEvent;
+
+static const uint button_pins[4] = {
+    BUTTON_LEFT_PIN, BUTTON_UP_PIN, BUTTON_RIGHT_PIN, BUTTON_DOWN_PIN
+};
+static struct { bool down, settling; } lanes[4];
+
+// Single producer (IRQ), single consumer (game loop): no locks needed.
+static ButtonEvent btn_q[BTN_QUEUE_LEN];
+static volatile uint32_t btn_head, btn_tail;
+static volatile uint32_t btn_dropped;
+
+static void button_push(int lane, bool down, absolute_time_t t) {
+    uint32_t h = btn_head;
+    if (h - btn_tail == BTN_QUEUE_LEN) {
+        btn_dropped++;
+        return;
+    }
+    btn_q[h & (BTN_QUEUE_LEN - 1)] = (ButtonEvent){ lane, down, t };
+    __dmb();                   // event visible before the index moves
+    btn_head = h + 1;
+}
+
+static int64_t button_settle(alarm_id_t id, void *user) {
+    (void)id;
+    int lane = (int)(intptr_t)user;
+    bool down = !replay_gpio_get(button_pins[lane]);
+    if (down == lanes[lane].down) {
+        lanes[lane].settling = false;
+        return 0;
+    }
+    lanes[lane].down = down;   // chatter hid the other edge
+    button_push(lane, down, get_absolute_time());
+    return DEBOUNCE_US;
+}
 
-    gpio_init(BUTTON_UP_PIN);
-    gpio_set_dir(BUTTON_UP_PIN, GPIO_IN);
-    gpio_pull_up(BUTTON_UP_PIN);
+static void button_irq(uint gpio, uint32_t events) {
+    absolute_time_t now = get_absolute_time();
+    for (int lane = 0; lane < 4; lane++) {
+        if (button_pins[lane] != gpio) continue;
+        if (lanes[lane].settling) return;
+        // Active-low; if both edges are latched, the pin level decides.
+        bool down = events == GPIO_IRQ_EDGE_FALL ? true
+                  : events == GPIO_IRQ_EDGE_RISE ? false : !replay_gpio_get(gpio);
+        if (down == lanes[lane].down) return;
+        lanes[lane].down = down;
+        lanes[lane].settling = true;
+        button_push(lane, down, now);
+        add_alarm_in_us(DEBOUNCE_US, button_settle, (void *)(intptr_t)lane, true);
+        return;
+    }
+}
 
-    gpio_init(BUTTON_RIGHT_PIN);
-    gpio_set_dir(BUTTON_RIGHT_PIN, GPIO_IN);
-    gpio_pull_up(BUTTON_RIGHT_PIN);
+void buttons_init() {
+    for (int lane = 0; lane < 4; lane++) {
+        gpio_init(button_pins[lane]);
+        gpio_set_dir(button_pins[lane], GPIO_IN);
+        gpio_pull_up(button_pins[lane]);
+        replay_gpio_set_irq_enabled_with_callback(button_pins[lane],
+            GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, true, button_irq);
+    }
+}
 
-    gpio_init(BUTTON_DOWN_PIN);
-    gpio_set_dir(BUTTON_DOWN_PIN, GPIO_IN);
-    gpio_pull_up(BUTTON_DOWN_PIN);
+// Take the oldest queued event; false if there is none.
+bool button_poll(ButtonEvent *ev) {
+    uint32_t t = btn_tail;
+    if (t == btn_head) return false;
+    *ev = btn_q[t & (BTN_QUEUE_LEN - 1)];
+    __dmb();
+    btn_tail = t + 1;
+    return true;
 }
 
-// Returns the button index pressed or -1 if none. (Active-low)
-int get_button_pressed() {
-    if (gpio_get(BUTTON_LEFT_PIN) == 0) return 0;
-    if (gpio_get(BUTTON_UP_PIN) == 0) return 1;
-    if (gpio_get(BUTTON_RIGHT_PIN) == 0) return 2;
-    if (gpio_get(BUTTON_DOWN_PIN) == 0) return 3;
+// Wait up to timeout_ms for a press made at or after `since` (earlier ones
+// are dropped). Returns its lane, or -1; *press gets the event.
+int wait_for_button_press(absolute_time_t since, uint32_t timeout_ms, ButtonEvent *press) {
+    absolute_time_t until = make_timeout_time_ms(timeout_ms);
+    do {
+        while (button_poll(press)) {
+            if (press->down && absolute_time_diff_us(since, press->t) >= 0) return press->lane;
+        }
+        sleep_ms(1);
+    } while (absolute_time_diff_us(get_absolute_time(), until) > 0);
     return -1;
 }
 
-// Wait for a button press (with debounce) up to timeout_ms.
-int wait_for_button_press(uint32_t timeout_ms) {
-    absolute_time_t start = get_absolute_time();
-    while (absolute_time_diff_us(start, get_absolute_time()) < timeout_ms * 1000) {
-        int button = get_button_pressed();
-        if (button != -1) {
-            sleep_ms(50); // simple debounce
-            while (get_button_pressed() != -1);
-            return button;
+// ---------- Audio ----------
+// 8-bit PWM on AUDIO_PIN (~488 kHz carrier; RC-filter it into an amp or
+// piezo). Two DMA channels, chained to each other, take turns playing a
+// block of samples into the slice's compare register, paced by a DMA timer
+// at audio_hz, so no CPU time is spent while a block plays. When one
+// finishes, the DMA IRQ mixes the block after next into it.
+//
+// The sample count is also the chart clock: a note due at sample n is
+// sounded at sample n and drawn and judged against audio_time(n). clk_sys
+// and the µs timer both run off the crystal, so the mapping does not drift.
+// The timer divides clk_sys down to about AUDIO_HZ; audio_init() reads the
+// clock, and every rate-dependent value derives from the rate it got.
+#define AUDIO_PIN       22
+#define AUDIO_HZ        25000            // wanted; the real rate is audio_hz
+#define AUDIO_BLOCK     256              // samples per DMA block (10.24 ms)
+#define AUDIO_Q_LEN     64               // scheduled tones, power of two
+#define AUDIO_VOICES    5                // one per lane, then effects
+#define VOICE_FX        4
+#define TAP_MS          160              // how long a tap's tone rings
+#define TONE_STEP(hz)   ((uint32_t)(((uint64_t)(hz) << 32) / audio_hz))
+
+typedef struct {
+    uint32_t phase, step;      // square wave: phase accumulator
+    uint16_t env, decay;       // level, falling by decay every sample
+} Voice;
+
+typedef struct {
+    uint32_t at;               // sample it starts on
+    uint8_t voice;
+    uint32_t step;
+    uint16_t decay;
+} ToneEvent;
+
+static const uint16_t lane_hz[4] = { 523, 659, 784, 1047 };   // LEFT UP RIGHT DOWN: C5 E5 G5 C6
+static uint32_t lane_step[4];
+
+static uint32_t audio_hz;                // clk_sys / the timer's divider (exact at 125 MHz)
+static uint32_t audio_buf[2][AUDIO_BLOCK];
+static int audio_dma[2];
+static uint audio_chan;
+static Voice voices[AUDIO_VOICES];
+static uint32_t audio_mixed;             // next sample to mix
+static absolute_time_t audio_t0;         // when sample 0 went out
+
+// Game → mixer: tones in time order, and one effect that plays at once.
+// Single producer, single consumer, as with the button queue.
+static ToneEvent tone_q[AUDIO_Q_LEN];
+static volatile uint32_t tone_head, tone_tail;
+static volatile uint32_t fx_step;
+
+static void audio_mix(uint32_t *out) {
+    TRACE_SCOPE(TR_AUDIO);
+    if (fx_step) {
+        voices[VOICE_FX] = (Voice){ 0, fx_step, 0x7FFF, 16 };
+        fx_step = 0;
+    }
+    for (int i = 0; i < AUDIO_BLOCK; i++, audio_mixed++) {
+        while (tone_tail != tone_head) {
+            const ToneEvent *e = &tone_q[tone_tail & (AUDIO_Q_LEN - 1)];
+            if ((int32_t)(e->at - audio_mixed) > 0) break;
+            voices[e->voice] = (Voice){ 0, e->step, 0x7FFF, e->decay };
+            tone_tail++;
+        }
+        int level = 128;
+        for (int v = 0; v < AUDIO_VOICES; v++) {
+            Voice *vo = &voices[v];
+            if (!vo->env) continue;
+            vo->phase += vo->step;
+            int amp = vo->env >> 10;
+            level += vo->phase >> 31 ? amp : -amp;
+            vo->env = vo->env > vo->decay ? vo->env - vo->decay : 0;
         }
-        sleep_ms(10);
+        if (level < 0) level = 0;
+        if (level > 255) level = 255;
+        out[i] = (uint32_t)level << (16 * audio_chan);
     }
-    return -1;
 }
 
-// ---------- Game Functions ----------
-// Add a new arrow command to the scrolling array.
-void add_arrow_command(int arrow, uint32_t delay_ms) {
-    if (arrow_count < MAX_ARROWS) {
-        arrows[arrow_count].arrow = arrow;
-        arrows[arrow_count].hit_time = make_timeout_time_ms(delay_ms);
-        arrows[arrow_count].hit = false;
-        arrow_count++;
+static void audio_irq(void) {
+    for (int b = 0; b < 2; b++) {
+        if (!dma_channel_get_irq0_status(audio_dma[b])) continue;
+        dma_channel_acknowledge_irq0(audio_dma[b]);
+        // The other channel is playing now; this buffer is next but one.
+        audio_mix(audio_buf[b]);
+        dma_channel_set_read_addr(audio_dma[b], audio_buf[b], false);
     }
 }
 
-// Update the display to show scrolling arrows using custom characters.
-void update_scrolling_arrows() {
-    lcd_clear();
-    // Display arrows on row 0. Their horizontal position is determined by time left.
-    for (int i = 0; i < arrow_count; i++) {
-        int time_diff_us = absolute_time_diff_us(get_absolute_time(), arrows[i].hit_time);
-        int pos = (int)(time_diff_us / 200000); // Adjusted for slower scroll speed
-        if (pos >= MAX_CHARS) pos = MAX_CHARS - 1;
-        if (pos < 0) pos = 0;
-        lcd_set_cursor(0, pos);
-        // Display the custom character corresponding to the arrow.
-        lcd_send_byte(arrows[i].arrow, LCD_CHARACTER);
+void audio_init(void) {
+    gpio_set_function(AUDIO_PIN, GPIO_FUNC_PWM);
+    uint slice = pwm_gpio_to_slice_num(AUDIO_PIN);
+    audio_chan = pwm_gpio_to_channel(AUDIO_PIN);
+    pwm_config pc = pwm_get_default_config();
+    pwm_config_set_clkdiv(&pc, 1.f);
+    pwm_config_set_wrap(&pc, 255);
+    pwm_init(slice, &pc, true);
+
+    uint32_t sys_hz = clock_get_hz(clk_sys);
+    uint32_t div = (sys_hz + AUDIO_HZ / 2) / AUDIO_HZ;
+    if (div > 0xFFFF) div = 0xFFFF;
+    audio_hz = sys_hz / div;
+    for (int lane = 0; lane < 4; lane++) lane_step[lane] = TONE_STEP(lane_hz[lane]);
+    int timer = dma_claim_unused_timer(true);
+    dma_timer_set_fraction(timer, 1, (uint16_t)div);
+    audio_dma[0] = dma_claim_unused_channel(true);
+    audio_dma[1] = dma_claim_unused_channel(true);
+    for (int b = 0; b < 2; b++) {
+        dma_channel_config c = dma_channel_get_default_config(audio_dma[b]);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+        channel_config_set_read_increment(&c, true);
+        channel_config_set_write_increment(&c, false);
+        channel_config_set_dreq(&c, dma_get_timer_dreq(timer));
+        channel_config_set_chain_to(&c, audio_dma[b ^ 1]);
+        dma_channel_configure(audio_dma[b], &c, &pwm_hw->slice[slice].cc,
+                              audio_buf[b], AUDIO_BLOCK, false);
+        dma_channel_set_irq0_enabled(audio_dma[b], true);
+        audio_mix(audio_buf[b]);
+    }
+    irq_set_exclusive_handler(DMA_IRQ_0, audio_irq);
+    irq_set_enabled(DMA_IRQ_0, true);
+    audio_t0 = get_absolute_time();
+    dma_channel_start(audio_dma[0]);
+}
+
+static inline absolute_time_t audio_time(uint32_t sample) {
+    return delayed_by_us(audio_t0, (uint64_t)sample * 1000000 / audio_hz);
+}
+
+static inline uint32_t audio_now(void) {
+    return (uint32_t)(absolute_time_diff_us(audio_t0, get_absolute_time()) * audio_hz / 1000000);
+}
+
+// Queue a lane's tone for sample `at`; callers go in time order. A tone
+// that does not fit is dropped, the arrow still plays.
+void audio_tone(uint32_t at, int lane, uint32_t hold_ms) {
+    uint32_t h = tone_head;
+    if (h - tone_tail == AUDIO_Q_LEN) return;
+    uint32_t len = (uint32_t)((uint64_t)(hold_ms ? hold_ms : TAP_MS) * audio_hz / 1000);
+    uint32_t decay = 0x7FFF / len;
+    tone_q[h & (AUDIO_Q_LEN - 1)] =
+        (ToneEvent){ at, (uint8_t)lane, lane_step[lane], (uint16_t)(decay ? decay : 1) };
+    __dmb();
+    tone_head = h + 1;
+}
+
+// A short effect, starting with the next block mixed.
+void audio_fx(uint32_t hz) {
+    fx_step = TONE_STEP(hz);
+}
+
+// ---------- Game Functions ----------
+// Add a new arrow command to the end of its lane (the caller checks room).
+void add_arrow_command(int arrow, absolute_time_t hit_time, uint32_t hold_ms) {
+    LaneQueue *q = &lanes_q[arrow];
+    q->notes[q->tail++ & (LANE_QUEUE_LEN - 1)] = (ArrowCommand){ arrow, hit_time, hold_ms };
+}
+
+static inline bool lane_full(int lane) {
+    return lanes_q[lane].tail - lanes_q[lane].head == LANE_QUEUE_LEN;
+}
+
+static inline ArrowCommand *lane_head(int lane) {
+    LaneQueue *q = &lanes_q[lane];
+    return q->head == q->tail ? NULL : &q->notes[q->head & (LANE_QUEUE_LEN - 1)];
+}
+
+int arrows_pending(void) {
+    int n = 0;
+    for (int lane = 0; lane < 4; lane++) n += lanes_q[lane].tail - lanes_q[lane].head;
+    return n;
+}
+
+// The round's chart is read one note at a time and only the next
+// LOOKAHEAD_MS of it (what the LCD can show) sits in the lane queues, so
+// RAM use is the same for five random arrows or a whole song.
+static ChartReader *chart;
+static ChartNote chart_note;         // read, not queued yet
+static bool chart_more;
+static uint32_t chart_s0;            // chart time 0, as an audio sample
+
+void chart_feed(absolute_time_t now) {
+    while (chart_more) {
+        uint32_t at = chart_s0 + (uint32_t)((uint64_t)chart_note.t_ms * audio_hz / 1000);
+        absolute_time_t t = audio_time(at);
+        if (absolute_time_diff_us(now, t) > LOOKAHEAD_MS * 1000) return;
+        for (int lane = 0; lane < 4; lane++) {
+            if ((chart_note.lanes >> lane & 1) && lane_full(lane)) return;
+        }
+        for (int lane = 0; lane < 4; lane++) {
+            if (!(chart_note.lanes >> lane & 1)) continue;
+            add_arrow_command(lane, t, chart_note.hold_ms);
+            audio_tone(at, lane, chart_note.hold_ms);
+        }
+        chart_more = chart_next(chart, &chart_note);
     }
 }
 
-// Provide quick visual feedback on the LCD.
+// Judgement text for line 1, shown for FEEDBACK_MS without stopping play.
+static const char *feedback_msg;
+static absolute_time_t feedback_until;
+
 void show_feedback(const char *msg) {
-    lcd_clear();
-    lcd_set_cursor(0, 0);
-    lcd_string(msg);
-    sleep_ms(500);
-    lcd_clear();
+    feedback_msg = msg;
+    feedback_until = make_timeout_time_ms(FEEDBACK_MS);
+}
+
+// Column on row 0 for something due at t; the horizontal position is
+// determined by time left.
+static int scroll_pos(absolute_time_t now, absolute_time_t t) {
+    int pos = (int)(absolute_time_diff_us(now, t) / (CELL_MS * 1000));
+    if (pos >= MAX_CHARS) pos = MAX_CHARS - 1;
+    if (pos < 0) pos = 0;
+    return pos;
+}
+
+// Update the display to show scrolling arrows using custom characters.
+void update_scrolling_arrows() {
+    TRACE_SCOPE(TR_LCD);
+    lcd_buf_clear();
+    absolute_time_t now = get_absolute_time();
+    // Hold tails first, as '=' up to where the hold ends; arrows go on top.
+    for (int lane = 0; lane < 4; lane++) {
+        if (holding[lane]) {
+            for (int p = 0, e = scroll_pos(now, hold_end[lane]); p <= e; p++) lcd_buf[0][p] = '=';
+        }
+        LaneQueue *q = &lanes_q[lane];
+        for (uint32_t i = q->head; i != q->tail; i++) {
+            const ArrowCommand *a = &q->notes[i & (LANE_QUEUE_LEN - 1)];
+            if (!a->hold_ms) continue;
+            int e = scroll_pos(now, delayed_by_ms(a->hit_time, a->hold_ms));
+            for (int p = scroll_pos(now, a->hit_time) + 1; p <= e; p++) lcd_buf[0][p] = '=';
+        }
+    }
+    for (int lane = 0; lane < 4; lane++) {
+        LaneQueue *q = &lanes_q[lane];
+        for (uint32_t i = q->head; i != q->tail; i++) {
+            const ArrowCommand *a = &q->notes[i & (LANE_QUEUE_LEN - 1)];
+            // Display the custom character corresponding to the arrow.
+            lcd_buf[0][scroll_pos(now, a->hit_time)] = a->arrow;
+        }
+    }
+    // Row 1: the last judgement, else which lanes are in their window now.
+    if (feedback_msg && absolute_time_diff_us(now, feedback_until) > 0) {
+        lcd_put(1, 0, feedback_msg);
+    } else {
+        int n = 0;
+        for (int lane = 0; lane < 4; lane++) {
+            ArrowCommand *a = lane_head(lane);
+            if (a && absolute_time_diff_us(now, a->hit_time) < HIT_WINDOW_MS * 1000)
+                lcd_buf[1][4 + n++] = a->arrow;
+        }
+        if (n) lcd_put(1, 0, "Hit ");
+    }
+    lcd_flush();
 }
 
 // Award points based on how close the timing was.
 void register_hit(uint32_t timing_diff_us) {
+    audio_fx(timing_diff_us < 200000 ? 1568 : 1175);
     if (timing_diff_us < 100000) {  // within 100ms = perfect hit
         score += 100 * (combo + 1);
         combo++;
@@ -305,53 +696,96 @@ void update_difficulty(int round) {
     }
 }
 
-// The main game loop for a round with scrolling arrows.
-void game_loop_scrolling(int round) {
-    arrow_count = 0;
-    combo = 0;
-    // Schedule a series of arrows.
-    for (int i = 0; i < sequence_length; i++) {
-        add_arrow_command(rand() % 4, base_delay_ms * (i + 1));
+// Arrows at the head of `lane` whose window closed before t are misses.
+static void expire_arrows(int lane, absolute_time_t t) {
+    ArrowCommand *a;
+    while ((a = lane_head(lane)) &&
+           absolute_time_diff_us(a->hit_time, t) > HIT_WINDOW_MS * 1000) {
+        lanes_q[lane].head++;
+        combo = 0;
+        audio_fx(98);
+        show_feedback("Miss!");
+    }
+}
+
+// Match a press against the head of its lane only; other lanes are judged
+// on their own presses. A press with no arrow in reach is ignored.
+static void judge_press(const ButtonEvent *ev) {
+    expire_arrows(ev->lane, ev->t);
+    ArrowCommand *a = lane_head(ev->lane);
+    if (!a) return;
+    int64_t diff_us = llabs(absolute_time_diff_us(a->hit_time, ev->t));
+    if (diff_us > HIT_WINDOW_MS * 1000) return;
+    lanes_q[ev->lane].head++;
+    if (a->hold_ms) {
+        holding[ev->lane] = true;
+        hold_end[ev->lane] = delayed_by_ms(a->hit_time, a->hold_ms);
     }
+    // Judge on when the button went down, not when we saw it.
+    register_hit((uint32_t)diff_us);
+}
+
+// A hold ends when its time is up, or early if the button comes up first.
+static void end_hold(int lane, absolute_time_t t) {
+    holding[lane] = false;
+    if (absolute_time_diff_us(t, hold_end[lane]) > HOLD_GRACE_MS * 1000) {
+        combo = 0;
+        audio_fx(98);
+        show_feedback("Let go!");
+    } else {
+        score += 50 * (combo + 1);
+        combo++;
+        show_feedback("Held!");
+    }
+}
+
+static bool any_holding(void) {
+    return holding[0] || holding[1] || holding[2] || holding[3];
+}
+
+// The main game loop for a round with scrolling arrows, played from `c`
+// (a compiled chart or the random generator).
+void game_loop_scrolling(ChartReader *c) {
+    memset(lanes_q, 0, sizeof(lanes_q));
+    memset(holding, 0, sizeof(holding));
+    combo = 0;
+    feedback_msg = NULL;
+    chart = c;
+    chart_more = chart_next(chart, &chart_note);
+    // Start past the blocks already mixed, so the first tone is not late.
+    chart_s0 = audio_now() + 2 * AUDIO_BLOCK;
     
-    // Run the scrolling loop until all arrows have been processed.
-    while (arrow_count > 0) {
-        update_scrolling_arrows();
-        sleep_ms(scroll_delay_ms);
-        
-        // Check each arrow to see if it is within the hit window.
-        for (int i = 0; i < arrow_count; i++) {
-            int32_t diff_us = (int32_t)absolute_time_diff_us(get_absolute_time(), arrows[i].hit_time);
-            if (!arrows[i].hit && (diff_us < HIT_WINDOW_MS * 1000)) {
-                lcd_set_cursor(1, 0);
-                lcd_string("Hit ");
-                lcd_send_byte(arrows[i].arrow, LCD_CHARACTER);
-                
-                int btn = wait_for_button_press(HIT_WINDOW_MS);
-                if (btn == arrows[i].arrow) {
-                    register_hit(diff_us);
-                    arrows[i].hit = true;
-                } else {
-                    combo = 0;
-                    show_feedback("Miss!");
-                    arrows[i].hit = true;
-                }
-            }
+    // Run the scrolling loop until the whole chart has been played.
+    while (chart_more || arrows_pending() > 0 || any_holding()) {
+        uint64_t t0 = trace_now();
+        ButtonEvent ev;
+        while (button_poll(&ev)) {
+            if (ev.down) judge_press(&ev);
+            else if (holding[ev.lane]) end_hold(ev.lane, ev.t);
         }
-        // Remove arrows that have passed their hit window.
-        int j = 0;
-        for (int i = 0; i < arrow_count; i++) {
-            if (absolute_time_diff_us(arrows[i].hit_time, get_absolute_time()) < (HIT_WINDOW_MS * 1000))
-                arrows[j++] = arrows[i];
+        absolute_time_t now = get_absolute_time();
+        for (int lane = 0; lane < 4; lane++) {
+            expire_arrows(lane, now);
+            if (holding[lane] && absolute_time_diff_us(hold_end[lane], now) >= 0) end_hold(lane, now);
         }
-        arrow_count = j;
+        chart_feed(now);
+        trace_span(TR_INPUT, t0);
+
+        update_scrolling_arrows();
+        t0 = trace_now();
+        sleep_ms(scroll_delay_ms);
+        trace_span(TR_WAIT, t0);
+        trace_frame();
     }
+    // Let the last judgement show before the score.
+    update_scrolling_arrows();
+    sleep_until(feedback_until);
     
-    lcd_clear();
+    lcd_buf_clear();
     char scoreStr[16];
     snprintf(scoreStr, sizeof(scoreStr), "Score: %d", score);
-    lcd_set_cursor(0, 0);
-    lcd_string(scoreStr);
+    lcd_put(0, 0, scoreStr);
+    lcd_flush();
     sleep_ms(3000);
 }
 
@@ -360,9 +794,10 @@ int main() {
     #warning i2c/lcd_1602_i2c example requires a board with I2C pins
 #else
     stdio_init_all();
+    replay_init();             // record, or replay a dump typed in at boot
     
     // Set I2C to 400kHz.
-    i2c_init(i2c_default, 400 * 1000);
+    i2c_init(i2c_default, LCD_I2C_HZ);
     gpio_set_function(PICO_DEFAULT_I2C_SDA_PIN, GPIO_FUNC_I2C);
     gpio_set_function(PICO_DEFAULT_I2C_SCL_PIN, GPIO_FUNC_I2C);
     gpio_pull_up(PICO_DEFAULT_I2C_SDA_PIN);
@@ -372,28 +807,38 @@ int main() {
     
     lcd_init_custom();
     buttons_init();
-    srand(time_us_32());
+    audio_init();
+    trace_init();
     
     int round = 1;
     score = 0;
     
     while (1) {
-        lcd_clear();
-        lcd_set_cursor(0, 0);
-        lcd_string("DDR Game!");
-        lcd_set_cursor(1, 0);
-        lcd_string("Press any btn");
-        while (get_button_pressed() == -1) {
-            sleep_ms(10);
+        lcd_buf_clear();
+        lcd_put(0, 0, "DDR Game!");
+        lcd_put(1, 0, "Any btn, \x01=song");
+        lcd_flush();
+        ButtonEvent press;
+        absolute_time_t shown = get_absolute_time();
+        while (wait_for_button_press(shown, 10, &press) == -1) {
+            trace_poll();
         }
-        while (get_button_pressed() != -1) {
-            sleep_ms(10);
+        
+        // UP plays the built-in song, anything else the next random round.
+        ChartReader round_chart;
+        if (press.lane == 1) {
+            chart_open(&round_chart, chart_demo);
+        } else {
+            update_difficulty(round);
+            chart_random(&round_chart, sequence_length, base_delay_ms);
+            round++;
         }
+        lcd_buf_clear();
+        lcd_put(0, 0, round_chart.title);
+        lcd_flush();
         sleep_ms(500);
         
-        update_difficulty(round);
-        game_loop_scrolling(round);
-        round++;
+        game_loop_scrolling(&round_chart);
     }
 #endif
     return 0;
@@ -1,89 +1,278 @@
 // -----------------------------------------------------------------------------
 // doom_V8.c  – stable OLED + joystick input via ADC for crosshair movement
-//   • OLED 128×64   → I²C-0  (GP16 = SDA , GP17 = SCL)  @100 kHz
+//   • OLED 128×64   → I²C-0  (GP16 = SDA , GP17 = SCL)  @1 MHz, DMA-fed,
+//                     self-recovering, 400 / 100 kHz fallback
 //   • Joystick VRX  → ADC0  (GP26)
 //   • Joystick VRY  → ADC1  (GP27)
 //   • Push-button    → GP15 (active-low)               (start / shoot)
 //   • Diagonal movement, velocity control, survival timer, win screen
+//   • 't' on the USB console dumps the frame trace (trace.h), 'r' the
+//     input recording (replay.h); a dump typed back at boot replays it
+//   • DOOM_STRESS=1: hundreds of enemies, no death, per-second cycle report
+//   • DOOM_RAYCAST=1: first-person raycast view, stick X turns, Y walks
 // -----------------------------------------------------------------------------
 
 #undef  PICO_DEFAULT_I2C_SDA_PIN
 #undef  PICO_DEFAULT_I2C_SCL_PIN
 #define PICO_DEFAULT_I2C_SDA_PIN 16
 #define PICO_DEFAULT_I2C_SCL_PIN 17
+#define OLED_SDA              PICO_DEFAULT_I2C_SDA_PIN
+#define OLED_SCL              PICO_DEFAULT_I2C_SCL_PIN
 #define i2c_default           i2c0             // OLED bus
 
 #define BTN_PIN               15               // GP15 (active-low)
 
+#ifndef DOOM_DUAL_CORE                         // 1: core1 owns the OLED bus,
+#define DOOM_DUAL_CORE        0                //    core0 simulates and draws
+#endif
+#ifndef DOOM_STRESS                            // 1: ramp to MAX_E live enemies
+#define DOOM_STRESS           0                //    to see how a frame scales
+#endif
+#ifndef DOOM_RAYCAST                           // 1: walk a tile map in first
+#define DOOM_RAYCAST          0                //    person instead of the flat view
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 #include <stdint.h>
-#include <math.h>
 #include "pico/stdlib.h"
 #include "pico/time.h"
 #include "hardware/i2c.h"
 #include "hardware/adc.h"
-#include "ssd1306_font.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "hardware/structs/systick.h"
+#if DOOM_DUAL_CORE
+#include "pico/multicore.h"
+#endif
+#include "ssd1306.h"
+#include "ssd1306_text.h"
+#include "replay.h"
+#include "trace.h"
+#include "joystick.h"
 
 // ─────────── Display constants ───────────────────────────────────────────────
 #define W        128
 #define H         64
 #define FB_LEN   (W * H / 8)
+#if DOOM_DUAL_CORE
+static uint8_t fb_buf[2][FB_LEN];                // drawn by core0, sent by core1
+static uint8_t *fb = fb_buf[0];
+#else
 static uint8_t fb[FB_LEN];
+#endif
 #define OLED_ADDR 0x3C
 
-// ─────────── ADC center calibration ──────────────────────────────────────────
-static uint16_t center_x_raw, center_y_raw;
-
 // ─────────── Joystick parameters ─────────────────────────────────────────────
 #define JOY_SPEED   12    // doubled speed
 
+// ─────────── Fixed-point (Q16.16) ────────────────────────────────────────────
+// The RP2040 has no FPU; game state is kept in Q16.16 so the hot loop never
+// touches the soft-float library.
+typedef int32_t fx_t;
+#define FX_SHIFT    16
+#define FX_ONE      (1 << FX_SHIFT)
+#define FX(v)       ((fx_t)((v) * FX_ONE))          // constants only
+static inline int  fx_int(fx_t a){ return a >> FX_SHIFT; }         // floor
+static inline int  fx_trunc(fx_t a){ return a<0 ? -((-a) >> FX_SHIFT) : a >> FX_SHIFT; }
+static inline fx_t fx_add_sat(fx_t a, fx_t b)
+{
+    int64_t r = (int64_t)a + b;
+    return r > INT32_MAX ? INT32_MAX : r < INT32_MIN ? INT32_MIN : (fx_t)r;
+}
+static inline fx_t fx_mul(fx_t a, fx_t b){ return (fx_t)(((int64_t)a * b) >> FX_SHIFT); }
+static inline int32_t clamp_i(int32_t v, int32_t lo, int32_t hi)
+{ return v<lo ? lo : v>hi ? hi : v; }
+
+// ─────────── Cycle probe ─────────────────────────────────────────────────────
+// SysTick as a free-running 24-bit down-counter on clk_sys (the M0+ has no
+// DWT cycle counter); fine for spans well under 2^24 cycles.
+static uint32_t cyc_update, cyc_cross, cyc_render;   // summed over one report period
+static inline void cyc_init(void)
+{ systick_hw->csr=0; systick_hw->rvr=0x00FFFFFF; systick_hw->cvr=0; systick_hw->csr=5; }
+static inline uint32_t cyc_now(void){ return systick_hw->cvr; }
+static inline uint32_t cyc_since(uint32_t t0){ return (t0 - systick_hw->cvr) & 0x00FFFFFF; }
+
 // ─────────── Game constants ──────────────────────────────────────────────────
-#define MAX_E       12
+#if DOOM_STRESS
+#define MAX_E       512   // pool the stress population ramps up to
+#else
+#define MAX_E       12    // most alive at once; kills free their slot
+#endif
 #define SPAWN_MS    1200  // twice as fast spawn
-#define GROWTH      1.5f  // twice as fast growth
-#define START_SZ    1.f
+#define GROWTH      FX(1.5)  // twice as fast growth
+#define START_SZ    FX(1)
 #define COLL_SZ     30
 #define SURVIVE_MS  15000 // survive 15 seconds
 
+// ─────────── Simulation timestep ─────────────────────────────────────────────
+// The game advances in fixed SIM_TICK_US steps fed from a time accumulator,
+// independent of how long a frame takes to draw and push. GROWTH and
+// JOY_SPEED were tuned per iteration of the old ~100 ms blocking loop, so
+// they are rescaled to the tick with PER_TICK().
+#define SIM_TICK_US   25000               // 40 Hz
+#define SIM_TICK_MS   (SIM_TICK_US/1000)
+#define REF_TICK_US   100000
+#define PER_TICK(v)   ((fx_t)((int64_t)(v) * SIM_TICK_US / REF_TICK_US))
+#define MAX_CATCHUP   8                   // ticks per frame before time is dropped
+// A frame is drawn after every tick, and between ticks no sooner than
+// DRAW_US after the last one, interpolated; the loop sleeps in between
+// rather than redrawing a picture that has not moved. First-person view
+// moves in whole ticks, so it draws on ticks only.
+#if DOOM_RAYCAST
+#define DRAW_US       SIM_TICK_US
+#else
+#define DRAW_US       (SIM_TICK_US/2)     // 80 fps at most
+#endif
+
+#if DOOM_RAYCAST
+// ─────────── First-person constants ──────────────────────────────────────────
+// Map positions are in tiles (Q16.16); angles are fine angles, ANG_N a turn.
+#define MAP_W       16
+#define MAP_H       16
+#define ANG_N       1024
+#define ANG_MASK    (ANG_N-1)
+#define PLANE       FX(0.66)            // camera plane half-width: a 66° view
+#define FOCAL       97                  // px, (W/2)/PLANE
+#define TURN_RATE   (ANG_N/2)           // fine angles/s at full stick
+#define MOVE_SPEED  FX(2)               // tiles/s at full stick
+#define PL_RADIUS   FX(0.25)            // how close the player gets to walls
+#define ENEMY_R     FX(0.3)             // sprite half-size, tiles
+#define ENEMY_SPEED FX(0.9)             // tiles/s
+#define TOUCH_DIST  FX(0.45)            // an enemy this close kills
+#define SPAWN_MIN   FX(4)               // spawns keep this far from the player
+#define NEAR_Z      FX(0.125)           // nearest depth drawn / projected
+#define RECIP_SHIFT 11                  // recip_tab[] step: 1/32 tile
+#define RECIP_N     1025                // ... out to 32 tiles
+#define PER_SEC(v)  ((fx_t)((int64_t)(v) * SIM_TICK_US / 1000000))
+#endif
+
 typedef enum { SQUARE, CIRCLE } shape_t;
-typedef struct { shape_t k; int16_t x; float s; uint8_t live; } enemy;
 
-static enemy E[MAX_E];
-static int    Ec = 0;
+// Live enemies are packed into [0, Ec), one array per field; a kill moves
+// the last one into its slot, so every loop touches only live enemies and
+// a spawn always appends.
+#if DOOM_RAYCAST
+static fx_t    E_x[MAX_E], E_y[MAX_E];  // map position, tiles
+static fx_t    E_d[MAX_E];     // distance to the player, kept far → near
+#else
+static int16_t E_x[MAX_E];     // centre column
+static fx_t    E_s[MAX_E];     // half-size, grows each tick
+#endif
+static uint8_t E_k[MAX_E];     // shape_t
+static int     Ec = 0;
 
-// crosshair position and timer
+// crosshair position (fx for sub-pixel velocity) and timer
+static fx_t cross_fx, cross_fy;
 static int cross_x, cross_y;
 static int seconds_left;
 
-// ─────────── I²C helper (retry for 500 µs) ───────────────────────────────────
-static bool i2c_write_safe(i2c_inst_t *bus, uint8_t addr,
-                           const uint8_t *b, size_t n)
+// ─────────── Self-recovering I²C ─────────────────────────────────────────────
+// The OLED bus starts at Fast-mode Plus (1 MHz; wants ~1 kΩ pull-ups) and
+// steps down a rate after I2C_DOWN_ERRS errors close together, back up after
+// I2C_QUIET_MS without one. A NAK is retried as is; a timeout means a slave
+// is holding SDA, so the bus is recovered: SCL is clocked by hand until SDA
+// is released, a STOP ends whatever was going on, the controller and the
+// panel are set up again and the panel RAM counts as unknown (next frame
+// goes out whole). Rates only change while no transfer is in flight.
+static const uint32_t i2c_rates[] = { 1000000, 400000, 100000 };
+#define I2C_RATES      (int)(sizeof i2c_rates / sizeof i2c_rates[0])
+#define I2C_TRIES      3          // attempts at a write before recovering
+#define I2C_DOWN_ERRS  3          // errors this close together → rate down
+#define I2C_QUIET_MS   5000       // this long error-free → rate up
+static volatile uint32_t i2c_retries, i2c_recoveries, i2c_naks, i2c_timeouts;
+static int      i2c_rate;                       // index into i2c_rates
+static uint32_t i2c_err_run, i2c_err_ms, i2c_rate_ms;
+
+static uint32_t now_ms(void){ return to_ms_since_boot(get_absolute_time()); }
+
+// Wire time of n bytes plus address at the current rate, twice over, plus
+// slack: past this a transfer is not slow, it is stuck.
+static uint32_t i2c_budget_us(size_t n)
+{ return (uint32_t)((n + 1) * 9 * 2000000ull / i2c_rates[i2c_rate]) + 200; }
+
+static void i2c_apply_rate(int r)
 {
-    absolute_time_t until = delayed_by_us(get_absolute_time(), 500);
-    while (true) {
-        if (i2c_write_timeout_us(bus, addr, b, n, false, 50) == (int)n) return true;
-        if (absolute_time_diff_us(until, get_absolute_time()) <= 0)      return false;
+    i2c_hw_t *hw = i2c_get_hw(i2c_default);
+    i2c_rate = r; i2c_rate_ms = now_ms();
+    hw->enable = 0;                             // timing registers need it off
+    i2c_set_baudrate(i2c_default, i2c_rates[r]);
+    hw->enable = 1;
+}
+static void i2c_error(void)
+{
+    uint32_t t = now_ms();
+    if (t - i2c_err_ms > I2C_QUIET_MS) i2c_err_run = 0;
+    i2c_err_ms = t;
+    if (++i2c_err_run >= I2C_DOWN_ERRS && i2c_rate < I2C_RATES-1) {
+        i2c_err_run = 0;
+        i2c_apply_rate(i2c_rate + 1);
+    }
+}
+static void i2c_tune(void)                      // bus idle
+{
+    uint32_t t = now_ms();
+    if (i2c_rate > 0 && t - i2c_err_ms >= I2C_QUIET_MS && t - i2c_rate_ms >= I2C_QUIET_MS)
+        i2c_apply_rate(i2c_rate - 1);
+}
+
+// Up to 9 clocks finish any byte a slave is stuck in; then STOP.
+static void i2c_bus_clear(void)
+{
+    gpio_set_dir(OLED_SDA, GPIO_IN);            // released: pull-up, or held low
+    gpio_set_function(OLED_SDA, GPIO_FUNC_SIO);
+    gpio_put(OLED_SCL, 1); gpio_set_dir(OLED_SCL, GPIO_OUT);
+    gpio_set_function(OLED_SCL, GPIO_FUNC_SIO);
+    for (int i=0; i<9 && !gpio_get(OLED_SDA); i++) {
+        gpio_put(OLED_SCL, 0); sleep_us(5);
+        gpio_put(OLED_SCL, 1); sleep_us(5);
     }
+    gpio_put(OLED_SCL, 0); sleep_us(5);
+    gpio_put(OLED_SDA, 0); gpio_set_dir(OLED_SDA, GPIO_OUT); sleep_us(5);
+    gpio_put(OLED_SCL, 1); sleep_us(5);
+    gpio_set_dir(OLED_SDA, GPIO_IN); sleep_us(5); // SDA rises with SCL high
+    gpio_set_function(OLED_SDA, GPIO_FUNC_I2C);
+    gpio_set_function(OLED_SCL, GPIO_FUNC_I2C);
+    i2c_init(i2c_default, i2c_rates[i2c_rate]);
 }
 
-// ─────────── OLED primitives ────────────────────────────────────────────────
-static inline void oled_cmd(uint8_t c)
-{ uint8_t p[2] = {0x80, c}; i2c_write_blocking(i2c_default, OLED_ADDR, p, 2, false); }
-static void oled_cmds(const uint8_t *s, size_t n) { while(n--) oled_cmd(*s++); }
-static void oled_data(const uint8_t *d, size_t n)
+static ssd1306_t oled;
+static void oled_config(void);
+static void i2c_recover(void)
+{
+    static bool busy;                           // the panel set-up writes land here
+    if (busy) return;
+    busy = true;
+    i2c_recoveries++;
+    i2c_bus_clear();
+    oled_config();
+    oled.shadow_ok = false;
+    busy = false;
+}
+
+// The OLED's write hook. False once the panel may hold a partial write:
+// after I2C_TRIES NAKs or a timeout, both of which end in a recovery.
+static bool i2c_write_safe(i2c_inst_t *bus, uint8_t addr,
+                           const uint8_t *b, size_t n)
 {
-    uint8_t chunk[17] = {0x40};
-    while (n) {
-        size_t len = n > 16 ? 16 : n;
-        memcpy(chunk+1, d, len);
-        i2c_write_blocking(i2c_default, OLED_ADDR, chunk, len+1, false);
-        d += len; n -= len;
+    for (int t=0; t<I2C_TRIES; t++) {
+        if (t) i2c_retries++;
+        int r = i2c_write_timeout_us(bus, addr, b, n, false, i2c_budget_us(n));
+        if (r == (int)n) return true;
+        i2c_error();
+        if (r == PICO_ERROR_TIMEOUT) { i2c_timeouts++; break; }
+        i2c_naks++;
     }
+    i2c_recover();
+    return false;
 }
-static void oled_init(void)
+
+// ─────────── OLED init (blocking) ───────────────────────────────────────────
+static ssd1306_t oled = { .bus = i2c_default, .addr = OLED_ADDR, .write = i2c_write_safe };
+static void oled_config(void)
 {
     static const uint8_t seq[] = {
         0xAE,0x20,0x00,0x40,0xA1,
@@ -92,15 +281,261 @@ static void oled_init(void)
         0xDB,0x20,0x81,0xFF,0xA4,0xA6,
         0x8D,0x14,0x2E,0xAF
     };
-    oled_cmds(seq, sizeof seq);
+    ssd1306_cmds(&oled, seq, sizeof seq);
+}
+static void oled_init(void)
+{
+    oled_config();
     sleep_ms(50);
+    printf("oled init: %lu B in %lu xfers\n",
+           (unsigned long)oled.bytes, (unsigned long)oled.xfers);
+}
+
+// ─────────── Frame presentation ─────────────────────────────────────────────
+// oled_present() hands the finished fb to the display path and returns a
+// ticket; oled_presented()/oled_wait() are the fence for it, passed once the
+// frame is on the panel: its last STOP is out, not just its DMA done. input_us
+// is when the input behind the frame was sampled, for input→photon latency,
+// measured to that same point.
+// oled.shadow mirrors what the panel will show once queued frames land;
+// px() flags the pages it touches and only their changed spans are sent.
+static volatile uint32_t frames_presented;
+static volatile uint32_t frames_landed;          // sent bytes, reached the panel intact
+static uint32_t          frames_queued;
+static uint8_t           fb_dirty;               // bit p → page p touched since present
+static uint32_t          input_us;
+static volatile uint32_t lat_sum, lat_n;          // input→photon of those, µs (monotonic)
+static volatile uint32_t oled_frame_tx;           // bytes sent by the last frame
+static volatile uint32_t oled_frame_xfers;        // transactions in the last frame
+
+static void fb_clear(void){ memset(fb,0,FB_LEN); fb_dirty=0xFF; }
+static bool oled_presented(uint32_t t){ return (int32_t)(frames_presented - t) >= 0; }
+
+#if DOOM_DUAL_CORE
+// ─────────── Core1 presenter ────────────────────────────────────────────────
+// Core0 draws into one of two framebuffers and passes its index through the
+// inter-core FIFO; core1 flushes it with the blocking transport and passes
+// the index back once the buffer may be redrawn. Core0 never touches the bus.
+static struct { uint32_t input_us; uint8_t dirty; } fb_meta[2];
+static int fb_cur, fb_in_flight;
+
+static void core1_presenter(void)
+{
+    while (true) {
+        uint32_t b = multicore_fifo_pop_blocking();
+        i2c_tune();
+        uint32_t bytes0 = oled.bytes, xfers0 = oled.xfers;
+        uint64_t t0 = trace_now();
+        ssd1306_flush(&oled, fb_buf[b], fb_meta[b].dirty);
+        trace_span(TR_FLUSH, t0);
+        oled_frame_tx = oled.bytes - bytes0;
+        oled_frame_xfers = oled.xfers - xfers0;
+        if (oled_frame_tx) {                      // as the DMA path: only frames that sent
+            lat_sum += time_us_32() - fb_meta[b].input_us; lat_n++;
+            if (oled.shadow_ok) frames_landed++;
+        }
+        frames_presented++;                       // the ticket counts every buffer
+        multicore_fifo_push_blocking(b);
+    }
+}
+
+static uint32_t oled_present(void)
+{
+    TRACE_SCOPE(TR_PRESENT);
+    fb_meta[fb_cur].input_us = input_us;
+    fb_meta[fb_cur].dirty = fb_dirty;
+    __dmb();                                      // fb + meta visible before the index
+    multicore_fifo_push_blocking(fb_cur);
+    fb_in_flight++; fb_dirty = 0;
+    // take back returned buffers; with both out, wait for the older one
+    uint64_t t0 = trace_now();
+    bool waited = fb_in_flight == 2;
+    while (fb_in_flight == 2 || (fb_in_flight && multicore_fifo_rvalid())) {
+        multicore_fifo_pop_blocking(); fb_in_flight--;
+    }
+    if (waited) trace_span(TR_WAIT, t0);
+    fb_cur ^= 1; fb = fb_buf[fb_cur];
+    return ++frames_queued;
+}
+static void oled_wait(uint32_t t){ while (!oled_presented(t)) tight_loop_contents(); }
+#else
+// ─────────── DMA frame push ─────────────────────────────────────────────────
+// A frame is encoded into a list of IC_DATA_CMD words (ssd1306_enc: one
+// command-list and one data transaction per span) and a DMA channel paced
+// by the I²C TX DREQ feeds it to the FIFO. There are two such wire buffers:
+// one on the bus and one queued behind it, so the game draws frame N+1 while
+// N is still going out. If the delta would outgrow a full frame, the full
+// frame is sent instead.
+// The DMA is done when the last word is in the 16-deep TX FIFO; the frame
+// has landed, and counts as presented, only once the FIFO has drained and
+// the last STOP is on the wire (the I²C IRQ, STOP_DET with TFE and the
+// master idle). Its interrupts are unmasked only while a buffer is out, so
+// blocking writes keep their own STOP_DET.
+// A NAK, even in the last bytes, aborts the transfer (TX_ABRT raises the
+// I²C IRQ), a stall is caught by oled_poll() against the buffer's time
+// budget; either way both buffers are dropped and the shadow, which already
+// holds what they would have shown, is sent whole once the bus is sorted
+// out.
+#define TX_WORDS (FB_LEN + 9)            // full frame: window list + 0x40 + data
+enum { TX_OK, TX_NAK, TX_STALL };
+static uint16_t tx_buf[2][TX_WORDS];
+static uint16_t *tx_w, *tx_end;          // encode cursor / limit
+static uint32_t  tx_len[2], tx_input[2], tx_ticket[2];
+static int       oled_dma;
+static volatile int8_t   tx_busy = -1;   // buffer on the wire (-1 = idle)
+static volatile int8_t   tx_next = -1;   // buffer queued behind it
+static volatile bool     tx_fed;         // its DMA is done, the FIFO holds the rest
+static volatile uint8_t  tx_fault;       // TX_NAK / TX_STALL, for oled_poll()
+static uint8_t           tx_fails;       // faults since the last clean buffer
+static uint64_t          tx_t0;          // when the buffer on the wire started
+static uint32_t          tx_start_us, tx_limit_us;
+
+#define TX_IDLE(hw) (((hw)->status & (I2C_IC_STATUS_TFE_BITS | I2C_IC_STATUS_MST_ACTIVITY_BITS)) \
+                     == I2C_IC_STATUS_TFE_BITS)
+
+static void oled_dma_start(int b)
+{
+    i2c_hw_t *hw = i2c_get_hw(i2c_default);
+    tx_busy = b; tx_fed = false; tx_t0 = trace_now();
+    tx_start_us = time_us_32(); tx_limit_us = i2c_budget_us(tx_len[b]);
+    (void)hw->clr_stop_det;                       // left over from earlier writes
+    hw->intr_mask = I2C_IC_INTR_MASK_M_TX_ABRT_BITS | I2C_IC_INTR_MASK_M_STOP_DET_BITS;
+    dma_channel_transfer_from_buffer_now(oled_dma, tx_buf[b], tx_len[b]);
+}
+// The buffer on the wire has landed: account for it, start the next one.
+static void oled_tx_landed(void)
+{
+    trace_span(TR_FLUSH, tx_t0);
+    lat_sum += time_us_32() - tx_input[tx_busy]; lat_n++;
+    frames_presented = tx_ticket[tx_busy]; frames_landed++;
+    tx_fails = 0;
+    int n = tx_next; tx_next = -1;
+    if (n >= 0) oled_dma_start(n);
+    else { tx_busy = -1; i2c_get_hw(i2c_default)->intr_mask = 0; }
+}
+static void oled_dma_irq(void)
+{
+    if (!dma_channel_get_irq0_status(oled_dma)) return;
+    dma_channel_acknowledge_irq0(oled_dma);
+    i2c_hw_t *hw = i2c_get_hw(i2c_default);
+    if (tx_busy < 0 || tx_fed) return;            // aborted meanwhile
+    tx_fed = true;
+    // the last STOP may have gone out before this ran; an abort is the I²C IRQ's
+    if (TX_IDLE(hw) && !(hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS)) oled_tx_landed();
+}
+static void oled_i2c_irq(void)
+{
+    i2c_hw_t *hw = i2c_get_hw(i2c_default);
+    if (tx_busy < 0) { hw->intr_mask = 0; return; }   // not ours: blocking writes
+    if (hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS) {
+        (void)hw->clr_tx_abrt;
+        dma_channel_abort(oled_dma);              // FIFO flushed: stop feeding it
+        dma_channel_acknowledge_irq0(oled_dma);
+        hw->intr_mask = 0;
+        tx_busy = tx_next = -1; tx_fault = TX_NAK;
+        oled.shadow_ok = false;                   // the panel is behind it
+        return;
+    }
+    (void)hw->clr_stop_det;                       // one per transaction
+    if (tx_fed && TX_IDLE(hw)) oled_tx_landed();
+}
+static void oled_dma_init(void)
+{
+    i2c_hw_t *hw = i2c_get_hw(i2c_default);
+    hw->enable = 0; hw->tar = OLED_ADDR; hw->enable = 1;
+    oled_dma = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(oled_dma);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, i2c_get_dreq(i2c_default, true));
+    dma_channel_configure(oled_dma, &c, &hw->data_cmd, NULL, 0, false);
+    dma_channel_set_irq0_enabled(oled_dma, true);
+    irq_set_exclusive_handler(DMA_IRQ_0, oled_dma_irq);
+    irq_set_enabled(DMA_IRQ_0, true);
+    hw->intr_mask = 0;
+    irq_set_exclusive_handler(I2C0_IRQ, oled_i2c_irq);  // i2c_default: I2C0
+    irq_set_enabled(I2C0_IRQ, true);
+}
+
+static void tx_window(int x0,int x1,int p0,int p1)
+{
+    const uint8_t a[] = {0x21,(uint8_t)x0,(uint8_t)x1,0x22,(uint8_t)p0,(uint8_t)p1};
+    tx_w = ssd1306_enc(&oled, tx_w, SSD1306_CTRL_CMD, a, sizeof a);
+}
+static bool tx_span(ssd1306_t *d,int x0,int x1,int p,const uint8_t *src)
+{
+    if (tx_w + 9 + (x1-x0+1) > tx_end) return false;
+    tx_window(x0,x1,p,p);
+    tx_w = ssd1306_enc(d, tx_w, SSD1306_CTRL_DATA, src, x1-x0+1);
+    return true;
 }
-static void oled_refresh(void)
+static void tx_full(int b,const uint8_t *src)
 {
-    const uint8_t a[] = {0x21,0,W-1,0x22,0,(H/8)-1};
-    oled_cmds(a, sizeof a);
-    oled_data(fb, FB_LEN);
+    tx_w = tx_buf[b];
+    tx_window(0,W-1,0,(H/8)-1);
+    tx_w = ssd1306_enc(&oled, tx_w, SSD1306_CTRL_DATA, src, FB_LEN);
+}
+
+// Turns a fault into retries / a recovery and a full resend; with the bus
+// idle, lets the rate climb back. Called wherever the game waits on it.
+static void oled_poll(void)
+{
+    uint32_t irq = save_and_disable_interrupts();
+    if (tx_busy >= 0 && time_us_32() - tx_start_us > tx_limit_us) {
+        dma_channel_abort(oled_dma);
+        dma_channel_acknowledge_irq0(oled_dma);
+        i2c_get_hw(i2c_default)->intr_mask = 0;
+        tx_busy = tx_next = -1; tx_fault = TX_STALL;
+    }
+    restore_interrupts(irq);
+    if (tx_fault == TX_OK) { if (tx_busy < 0) i2c_tune(); return; }
+    int f = tx_fault; tx_fault = TX_OK;
+    i2c_error();
+    if (f == TX_STALL) i2c_timeouts++; else i2c_naks++;
+    if (f == TX_STALL || ++tx_fails >= I2C_TRIES) { tx_fails = 0; i2c_recover(); }
+    else i2c_retries++;
+    tx_full(0, oled.shadow);
+    oled.shadow_ok = true;
+    tx_len[0] = tx_w - tx_buf[0];
+    tx_input[0] = input_us; tx_ticket[0] = frames_queued;
+    irq = save_and_disable_interrupts();
+    oled_dma_start(0);
+    restore_interrupts(irq);
+}
+static void oled_wait(uint32_t t){ while (!oled_presented(t)) { oled_poll(); tight_loop_contents(); } }
+
+static uint32_t oled_present(void)
+{
+    TRACE_SCOPE(TR_PRESENT);
+    oled_poll();
+    if (tx_next >= 0) {                             // both wire buffers in use
+        uint64_t t0 = trace_now();
+        while (tx_next >= 0) { oled_poll(); tight_loop_contents(); }
+        trace_span(TR_WAIT, t0);
+    }
+    int b = (tx_busy == 0) ? 1 : 0;
+    uint32_t bytes0 = oled.bytes, xfers0 = oled.xfers;
+    tx_w = tx_buf[b]; tx_end = tx_buf[b] + TX_WORDS;
+    if (!oled.shadow_ok || !ssd1306_delta(&oled, fb, fb_dirty, tx_span)) {
+        oled.bytes = bytes0; oled.xfers = xfers0;
+        tx_full(b, fb);
+        memcpy(oled.shadow, fb, FB_LEN);
+        oled.shadow_ok = true;
+    }
+    fb_dirty = 0;
+    tx_len[b] = tx_w - tx_buf[b];
+    tx_input[b] = input_us;
+    oled_frame_tx = oled.bytes - bytes0;
+    oled_frame_xfers = oled.xfers - xfers0;
+    if (!tx_len[b]) return frames_queued;               // nothing changed
+    tx_ticket[b] = ++frames_queued;
+    uint32_t irq = save_and_disable_interrupts();
+    if (tx_busy < 0) oled_dma_start(b); else tx_next = b;
+    restore_interrupts(irq);
+    return frames_queued;
 }
+#endif
 
 // ─────────── Pixel & text helpers ───────────────────────────────────────────
 static inline void px(int x,int y,int on)
@@ -108,105 +543,483 @@ static inline void px(int x,int y,int on)
     if ((unsigned)x>=W||(unsigned)y>=H) return;
     uint16_t idx=(y>>3)*W+x; uint8_t m=1u<<(y&7);
     fb[idx] = on ? (fb[idx]|m) : (fb[idx]&~m);
+    fb_dirty |= 1u<<(y>>3);
+    trace_add(TC_PIXELS, 1);
 }
-extern uint8_t font[];
-static int gi(char c){
-    if(c>='A'&&c<='Z') return 1+(c-'A');
-    if(c>='a'&&c<='z') return 1+(c-'a');
-    if(c>='0'&&c<='9') return 27+(c-'0');
-    if(c=='!') return 37; if(c=='-') return 38;
-    return 0;
+static inline void px_inv(int x,int y)
+{
+    if ((unsigned)x>=W||(unsigned)y>=H) return;
+    fb[(y>>3)*W+x] ^= 1u<<(y&7);
+    fb_dirty |= 1u<<(y>>3);
 }
-static void glyph8(int x,int y,int g){
-    const uint8_t *s=&font[g*8];
-    for(int cx=0;cx<8;cx++) for(int cy=0;cy<8;cy++)
-        px(x+cx,y+cy, (s[cx]>>(cy))&1);
+
+// ─────────── Filled primitives (page-byte spans) ────────────────────────────
+// fb is column-of-page-bytes, so a vertical run is one masked byte at each
+// end plus whole 0xFF bytes in between; cost grows with columns × pages
+// instead of area.
+static inline uint8_t page_bits(int y0,int y1)
+{ return (uint8_t)((2u<<(y1>>3)) - (1u<<(y0>>3))); }
+// pat is the byte ORed into each page: 0xFF solid, 0x55/0xAA a dither.
+static inline void vspan_pat(int x,int y0,int y1,uint8_t pat)   // y0..y1 already clipped
+{
+    int p0=y0>>3, p1=y1>>3;
+    uint8_t m0=0xFF<<(y0&7), m1=0xFF>>(7-(y1&7));
+    uint8_t *c=&fb[p0*W+x];
+    trace_add(TC_PIXELS, y1-y0+1);
+    if (p0==p1) { *c |= m0&m1&pat; return; }
+    *c |= m0&pat; c+=W;
+    for (int p=p0+1; p<p1; p++, c+=W) *c |= pat;
+    *c |= m1&pat;
+}
+static inline void vspan(int x,int y0,int y1){ vspan_pat(x,y0,y1,0xFF); }
+static inline void vspan_clr(int x,int y0,int y1)                // y0..y1 already clipped
+{
+    int p0=y0>>3, p1=y1>>3;
+    uint8_t m0=0xFF<<(y0&7), m1=0xFF>>(7-(y1&7));
+    uint8_t *c=&fb[p0*W+x];
+    if (p0==p1) { *c &= ~(m0&m1); return; }
+    *c &= ~m0; c+=W;
+    for (int p=p0+1; p<p1; p++, c+=W) *c = 0;
+    *c &= ~m1;
+}
+
+static void dstr(int x,int y,const char*s){
+    fb_dirty |= ssd1306_text(fb,x,y,s);            // page bytes, see ssd1306_text.h
+    trace_add(TC_PIXELS, 64*strlen(s));
 }
-static void dstr(int x,int y,const char*s){for(;*s;++s,x+=8)glyph8(x,y,gi(*s));}
 static void center(int y,const char*s){dstr((W-strlen(s)*8)/2,y,s);}  
 static void framed(const char*msg){
-    memset(fb,0,FB_LEN);
+    fb_clear();
     dstr(0,H/2-16,"----------------");
     center(H/2-4,msg);
     dstr(0,H/2+8,"----------------");
-    oled_refresh();
+    input_us = time_us_32();
+    oled_wait(oled_present());           // screen timing starts once it's shown
+    trace_add(TC_I2C_BYTES, oled_frame_tx); trace_add(TC_I2C_XFERS, oled_frame_xfers);
+    trace_frame();
+}
+
+#if DOOM_RAYCAST
+// ─────────── Raycaster ───────────────────────────────────────────────────────
+// One DDA ray per column through the tile map; the wall it hits becomes one
+// vertical run, a few page-byte writes. Enemies are billboards drawn far to
+// near, every column clipped against the wall depth in zbuf[]. Trig and
+// 1/depth come from tables built once at boot; a ray's per-tile step costs
+// one divide on the SIO hardware divider.
+static const char map[MAP_H][MAP_W+1] = {
+    "################",
+    "#..............#",
+    "#.##........##.#",
+    "#.#..........#.#",
+    "#..............#",
+    "#....#....#....#",
+    "#..............#",
+    "#......##......#",
+    "#......##......#",
+    "#..............#",
+    "#....#....#....#",
+    "#..............#",
+    "#.#..........#.#",
+    "#.##........##.#",
+    "#..............#",
+    "################",
+};
+#define PL_START_X  FX(2.5)             // west side of the arena,
+#define PL_START_Y  FX(8)               // facing the middle pillar
+#define PL_START_A  0
+
+static fx_t     sin_tab[ANG_N];
+static fx_t     cam_tab[W];             // column → camera-plane offset, -1..1
+static fx_t     recip_tab[RECIP_N];     // 32/i: 1/depth at depth i/32 tiles
+static fx_t     zbuf[W];                // wall depth per column, last frame
+static fx_t     pl_x, pl_y;             // player, tiles
+static uint32_t pl_a;                   // facing, fine angles << FX_SHIFT
+static fx_t     view_dx, view_dy;       // unit vector of the facing
+
+static inline fx_t fsin(int a){ return sin_tab[a & ANG_MASK]; }
+static inline fx_t fcos(int a){ return sin_tab[(a + ANG_N/4) & ANG_MASK]; }
+static inline bool solid(int x,int y)
+{ return (unsigned)x>=MAP_W || (unsigned)y>=MAP_H || map[y][x]=='#'; }
+
+// |(dx,dy)| to within 7%: max + 3/8 min, no square root.
+static inline fx_t fx_dist(fx_t dx,fx_t dy)
+{
+    dx=abs(dx); dy=abs(dy);
+    return dx>dy ? dx+(dy*3>>3) : dy+(dx*3>>3);
+}
+
+// 1/d, linear between table entries; d is clamped to NEAR_Z..32 tiles.
+static inline fx_t recip(fx_t d)
+{
+    if (d < NEAR_Z) d = NEAR_Z;
+    uint32_t i = (uint32_t)d >> RECIP_SHIFT, f = (uint32_t)d & ((1u<<RECIP_SHIFT)-1);
+    if (i >= RECIP_N-1) return recip_tab[RECIP_N-1];
+    return recip_tab[i] - (fx_t)(((uint32_t)(recip_tab[i] - recip_tab[i+1]) * f) >> RECIP_SHIFT);
+}
+
+// Ray length per tile crossed along an axis the ray moves `r` on, capped
+// so that 32 steps still fit an fx_t.
+static inline fx_t ray_step(fx_t r)
+{
+    uint32_t u = (uint32_t)abs(r);
+    return u < 256 ? FX(256) : (fx_t)(0xFFFFFFFFu / u);
+}
+
+// sin() from its Taylor series in Q30 over a quarter turn, mirrored into
+// the rest; keeps libm and soft float out of the build.
+static void ray_init(void)
+{
+    for (int a=0; a<=ANG_N/4; a++) {
+        int64_t x = (int64_t)a * 1686629714 / (ANG_N/4);     // π/2 in Q30
+        int64_t t = x, s = x;
+        for (int k=1; k<8; k++) { t = -(((t * x) >> 30) * x >> 30) / (2*k*(2*k+1)); s += t; }
+        fx_t v = (fx_t)((s + (1 << 13)) >> 14);
+        sin_tab[a] = sin_tab[(ANG_N/2 - a) & ANG_MASK] = v;
+        sin_tab[(ANG_N/2 + a) & ANG_MASK] = sin_tab[(ANG_N - a) & ANG_MASK] = -v;
+    }
+    for (int x=0; x<W; x++) cam_tab[x] = (fx_t)((int64_t)(2*x + 1 - W) * FX_ONE / W);
+    for (int i=0; i<RECIP_N; i++) recip_tab[i] = (fx_t)((32u << FX_SHIFT) / (i ? i : 1));
+}
+
+// Walls: x-facing sides a checker, y-facing sides sparser, and the first
+// column of every face plus each run's ends solid, so edges read on 1 bit.
+static void draw_walls(void)
+{
+    fx_t plx = -fx_mul(view_dy, PLANE), ply = fx_mul(view_dx, PLANE);
+    int mx0 = fx_int(pl_x), my0 = fx_int(pl_y), last = -1;
+    for (int x=0; x<W; x++) {
+        fx_t rx = view_dx + fx_mul(plx, cam_tab[x]), ry = view_dy + fx_mul(ply, cam_tab[x]);
+        fx_t ddx = ray_step(rx), ddy = ray_step(ry);
+        int mx = mx0, my = my0, sx = rx<0 ? -1 : 1, sy = ry<0 ? -1 : 1, side = 0;
+        fx_t tx = fx_mul(rx<0 ? pl_x - (mx << FX_SHIFT) : ((mx+1) << FX_SHIFT) - pl_x, ddx);
+        fx_t ty = fx_mul(ry<0 ? pl_y - (my << FX_SHIFT) : ((my+1) << FX_SHIFT) - pl_y, ddy);
+        for (int n=0; n<MAP_W+MAP_H; n++) {
+            if (tx < ty) { tx += ddx; mx += sx; side = 0; }
+            else         { ty += ddy; my += sy; side = 1; }
+            if (solid(mx,my)) break;
+        }
+        fx_t z = side ? ty - ddy : tx - ddx;
+        zbuf[x] = z;
+        int h = fx_int(FOCAL * recip(z)) / 2;
+        int y0 = H/2 - h < 0 ? 0 : H/2 - h, y1 = H/2 + h > H-1 ? H-1 : H/2 + h;
+        int face = (my*MAP_W + mx)*2 + side;
+        uint8_t pat = face != last ? 0xFF : side ? ((x&1) ? 0x44 : 0x11) : ((x&1) ? 0xAA : 0x55);
+        last = face;
+        vspan_pat(x, y0, y1, pat);
+        if (h < H/2) { fb[(y0>>3)*W+x] |= 1u<<(y0&7); fb[(y1>>3)*W+x] |= 1u<<(y1&7); }
+    }
+}
+
+// Enemy i in view space: depth z along the facing, centre column sx and
+// half-size r in px. False if it is behind the near plane.
+static bool enemy_view(int i, fx_t *z, int *sx, int *r)
+{
+    fx_t rx = E_x[i] - pl_x, ry = E_y[i] - pl_y;
+    fx_t d = fx_mul(rx, view_dx) + fx_mul(ry, view_dy);
+    if (d < NEAR_Z) return false;
+    fx_t lat = fx_mul(ry, view_dx) - fx_mul(rx, view_dy), inv = recip(d);
+    *z = d;
+    *sx = W/2 + fx_int(fx_mul(lat, inv) * FOCAL);
+    *r = fx_int(fx_mul(ENEMY_R * FOCAL, inv));
+    return true;
+}
+
+#endif
+
+// ─────────── Sprite cache ───────────────────────────────────────────────────
+// Enemies come in whole-pixel half-sizes and are always centred on row H/2,
+// so each (shape, r ≤ SPR_MAX_R) is rasterised once at boot into page bytes
+// in screen alignment: columns dx = 0..r+1 of the right half, mirrored when
+// drawn. Drawing is one OR per page per column, and shoot() tests the same
+// bits. The raycast view also keeps a hull per size (the ink grown by 1 px)
+// that it clears first, for a black rim against the walls.
+#define SPR_MAX_R     31                       // hull rows still start at 0
+#define SPR_COLS      ((SPR_MAX_R+1)*(SPR_MAX_R+4)/2)
+#define SPR_COL(r,dx) ((r)*((r)+3)/2 + (dx))   // Σ (j+2) over j < r, + dx
+static uint8_t spr_ink[2][SPR_COLS][H/8];
+#if DOOM_RAYCAST
+static uint8_t spr_hull[2][SPR_COLS][H/8];
+#endif
+
+// Half-height of column dx of shape k at half-size r, -1 past its edge. The
+// circle's is the largest h with dx²+h² ≤ r², as a per-pixel test would.
+static int spr_half(int k,int r,int dx)
+{
+    if (dx>r) return -1;
+    if (k==SQUARE) return r;
+    int h=r;
+    while (dx*dx+h*h > r*r) h--;
+    return h;
+}
+#if DOOM_RAYCAST
+static int spr_hull_half(int k,int r,int dx)
+{
+    int h=spr_half(k,r,dx), l=spr_half(k,r,dx ? dx-1 : 1), n=spr_half(k,r,dx+1);
+    if (l>h) h=l;
+    if (n>h) h=n;
+    return h<0 ? -1 : h+1;
+}
+#endif
+static void spr_column(uint8_t *col,int h)
+{
+    for (int y=H/2-h; y<=H/2+h; y++)
+        if ((unsigned)y<H) col[y>>3] |= 1u<<(y&7);
+}
+static void spr_init(void)
+{
+    for (int k=0; k<2; k++)
+        for (int r=0; r<=SPR_MAX_R; r++)
+            for (int dx=0; dx<=r+1; dx++) {
+                spr_column(spr_ink[k][SPR_COL(r,dx)], spr_half(k,r,dx));
+#if DOOM_RAYCAST
+                spr_column(spr_hull[k][SPR_COL(r,dx)], spr_hull_half(k,r,dx));
+#endif
+            }
+}
+
+// Whether (x,y) is ink of shape k at half-size r centred on (cx, H/2).
+static bool spr_hit(int k,int cx,int r,int x,int y)
+{
+    int dx=abs(x-cx);
+    if (dx>r || (unsigned)y>=H) return false;
+    if (r>SPR_MAX_R) return abs(y-H/2) <= spr_half(k,r,dx);    // raycast, point blank
+    return spr_ink[k][SPR_COL(r,dx)][y>>3] >> (y&7) & 1;
+}
+
+// Shape k at half-size r centred on (cx, H/2). The raycast view skips the
+// columns at or behind the wall depth in zbuf[]; past the cache (an enemy
+// in the player's face) it draws the same columns as runs.
+static void spr_draw(int k,int cx,int r,fx_t z)
+{
+#if DOOM_RAYCAST
+    int e=r+1;                                  // hull reaches one column out
+#else
+    int e=r;
+#endif
+    int x0=cx-e<0 ? 0 : cx-e, x1=cx+e>W-1 ? W-1 : cx+e;
+#if DOOM_RAYCAST
+    if (r>SPR_MAX_R) {
+        for (int x=x0; x<=x1; x++) {
+            if (z>=zbuf[x]) continue;
+            int h=spr_half(k,r,abs(x-cx)), g=spr_hull_half(k,r,abs(x-cx));
+            vspan_clr(x, H/2-g<0 ? 0 : H/2-g, H/2+g>H-1 ? H-1 : H/2+g);
+            if (h>=0) vspan(x, H/2-h<0 ? 0 : H/2-h, H/2+h>H-1 ? H-1 : H/2+h);
+        }
+        fb_dirty=0xFF;
+        return;
+    }
+#else
+    (void)z;
+    if (r>SPR_MAX_R) r=SPR_MAX_R;
+#endif
+    int y0=H/2-r-1<0 ? 0 : H/2-r-1, y1=H/2+r+1>H-1 ? H-1 : H/2+r+1;
+    int p0=y0>>3, p1=y1>>3;
+    for (int x=x0; x<=x1; x++) {
+        int col=SPR_COL(r,abs(x-cx));
+        const uint8_t *m=spr_ink[k][col];
+        uint8_t *c=&fb[p0*W+x];
+#if DOOM_RAYCAST
+        if (z>=zbuf[x]) continue;
+        const uint8_t *g=spr_hull[k][col];
+        for (int p=p0; p<=p1; p++, c+=W) *c = (*c & ~g[p]) | m[p];
+#else
+        for (int p=p0; p<=p1; p++, c+=W) *c |= m[p];
+#endif
+        trace_add(TC_PIXELS, 8*(p1-p0+1));
+    }
+    fb_dirty |= page_bits(y0,y1);
 }
 
 // ─────────── Spawn/update ───────────────────────────────────────────────────
-static void spawn(void){
-    if(Ec<MAX_E){
-        int margin=(int)START_SZ;
-        int xpos=rand()%(W-2*margin)+margin;
-        E[Ec++] = (enemy){ .k=(rand()&1)?SQUARE:CIRCLE,
-                           .x=xpos,
-                           .s=START_SZ,
-                           .live=1};
+static void despawn(int i){
+    Ec--; E_x[i]=E_x[Ec]; E_k[i]=E_k[Ec];
+#if DOOM_RAYCAST
+    E_y[i]=E_y[Ec]; E_d[i]=E_d[Ec];
+#else
+    E_s[i]=E_s[Ec];
+#endif
+}
+#if DOOM_RAYCAST
+// On a random open tile out of reach; false if the pool is full or no try
+// found one.
+static bool spawn(void){
+    if(Ec>=MAX_E) return false;
+    for(int tries=0;tries<8;tries++){
+        int tx=replay_rand()%MAP_W, ty=replay_rand()%MAP_H;
+        fx_t x=(tx<<FX_SHIFT)+FX_ONE/2, y=(ty<<FX_SHIFT)+FX_ONE/2;
+        if(solid(tx,ty) || fx_dist(x-pl_x,y-pl_y)<SPAWN_MIN) continue;
+        E_k[Ec]=(replay_rand()&1)?SQUARE:CIRCLE;
+        E_x[Ec]=x; E_y[Ec]=y; E_d[Ec]=fx_dist(x-pl_x,y-pl_y);
+        Ec++;
+        return true;
     }
+    return false;
 }
+// Enemies walk straight at the player, sliding along walls.
 static int update(void){
     int col=0;
-    for(int i=0;i<Ec;i++){
-        if(E[i].live && (E[i].s+=GROWTH)>=COLL_SZ) col=1;
+    fx_t step=PER_SEC(ENEMY_SPEED);
+    for(int i=0;i<Ec;){
+        fx_t dx=pl_x-E_x[i], dy=pl_y-E_y[i], d=fx_dist(dx,dy);
+        if(d<TOUCH_DIST){
+#if DOOM_STRESS
+            despawn(i); continue;            // recycle instead of dying
+#else
+            col=1;
+#endif
+        }
+        int32_t q=(d>>8)|1;                  // (dx,dy)/q: unit vector in Q8
+        fx_t nx=E_x[i]+((dx/q)*step>>8), ny=E_y[i]+((dy/q)*step>>8);
+        if(!solid(fx_int(nx),fx_int(E_y[i]))) E_x[i]=nx;
+        if(!solid(fx_int(E_x[i]),fx_int(ny))) E_y[i]=ny;
+        E_d[i]=d;
+        i++;
+    }
+    // far → near for the painter; the order barely changes between ticks,
+    // so this insertion sort is about one pass
+    for(int i=1;i<Ec;i++){
+        fx_t x=E_x[i], y=E_y[i], d=E_d[i]; uint8_t k=E_k[i];
+        int j=i;
+        for(; j>0 && E_d[j-1]<d; j--){ E_x[j]=E_x[j-1]; E_y[j]=E_y[j-1]; E_d[j]=E_d[j-1]; E_k[j]=E_k[j-1]; }
+        E_x[j]=x; E_y[j]=y; E_d[j]=d; E_k[j]=k;
+    }
+    return col;
+}
+#else
+static bool spawn(void){
+    if(Ec>=MAX_E) return false;
+    int margin=fx_int(START_SZ);
+    E_k[Ec]=(replay_rand()&1)?SQUARE:CIRCLE;
+    E_x[Ec]=replay_rand()%(W-2*margin)+margin;
+    E_s[Ec]=START_SZ;
+    Ec++;
+    return true;
+}
+static int update(void){
+    int col=0;
+    for(int i=0;i<Ec;){
+        if((E_s[i]=fx_add_sat(E_s[i],PER_TICK(GROWTH)))>=FX(COLL_SZ)){
+#if DOOM_STRESS
+            despawn(i); continue;            // recycle instead of dying
+#else
+            col=1;
+#endif
+        }
+        i++;
     }
     return col;
 }
+#endif
 
 // ─────────── Crosshair via joystick (velocity mode) ─────────────────────────
+#if DOOM_RAYCAST
+// The stick steers instead: X turns, Y walks (up is forward) and slides
+// along walls; the crosshair stays in the middle of the view.
 static void update_crosshair(void){
-    adc_select_input(0); uint x=adc_read();
-    adc_select_input(1); uint y=adc_read();
-    float jx=((float)x-center_x_raw)/2048.0f;
-    float jy=((float)y-center_y_raw)/2048.0f;
-    jx=fmaxf(-1,fminf(1,jx)); jy=fmaxf(-1,fminf(1,jy));
-    cross_x += (int)(jx * JOY_SPEED);
-    cross_y += (int)(jy * JOY_SPEED);
-    cross_x = fmax(4, fmin(W-5, cross_x));
-    cross_y = fmax(4, fmin(H-5, cross_y));
+    TRACE_SCOPE(TR_INPUT);
+    fx_t jx=clamp_i(joy_axis(0) * (FX_ONE/2048), -FX_ONE, FX_ONE);
+    fx_t jy=clamp_i(joy_axis(1) * (FX_ONE/2048), -FX_ONE, FX_ONE);
+    pl_a += (uint32_t)PER_SEC(jx * TURN_RATE);
+    int a = (int)(pl_a >> FX_SHIFT);
+    view_dx = fcos(a); view_dy = fsin(a);
+    fx_t step = PER_SEC(fx_mul(-jy, MOVE_SPEED));
+    fx_t nx = pl_x + fx_mul(step, view_dx), ny = pl_y + fx_mul(step, view_dy);
+    fx_t rx = nx > pl_x ? PL_RADIUS : -PL_RADIUS, ry = ny > pl_y ? PL_RADIUS : -PL_RADIUS;
+    if (!solid(fx_int(nx + rx), fx_int(pl_y))) pl_x = nx;
+    if (!solid(fx_int(pl_x), fx_int(ny + ry))) pl_y = ny;
 }
+#else
+static void update_crosshair(void){
+    TRACE_SCOPE(TR_INPUT);
+    // filtered, centred stick from the DMA ring: no ADC wait here
+    // (x-center)/2048 in Q16.16 is a multiply by 32, then clamp to ±1
+    fx_t jx=clamp_i(joy_axis(0) * (FX_ONE/2048), -FX_ONE, FX_ONE);
+    fx_t jy=clamp_i(joy_axis(1) * (FX_ONE/2048), -FX_ONE, FX_ONE);
+    cross_fx = clamp_i(fx_add_sat(cross_fx, PER_TICK(jx * JOY_SPEED)), FX(4), FX(W-5));
+    cross_fy = clamp_i(fx_add_sat(cross_fy, PER_TICK(jy * JOY_SPEED)), FX(4), FX(H-5));
+    cross_x = fx_trunc(cross_fx);
+    cross_y = fx_trunc(cross_fy);
+}
+#endif
 
 // ─────────── Render & shoot ─────────────────────────────────────────────────
-static void render_world(void){
-    memset(fb,0,FB_LEN);
-    // move & draw crosshair
-    update_crosshair();
+// alpha (Q16.16, 0..1) is how far wall time is into the next tick; enemy
+// sizes are drawn interpolated back from the last tick by (1-alpha).
+static void render_world(fx_t alpha){
+    uint64_t t0 = trace_now();
+    uint32_t c0 = cyc_now();
+    fb_clear();
+#if DOOM_RAYCAST
+    (void)alpha;                         // the view moves in whole ticks
+    draw_walls();
+    for(int i=0;i<Ec;i++){               // pool is kept far → near
+        fx_t z; int sx, r;
+        if(enemy_view(i,&z,&sx,&r)) spr_draw(E_k[i],sx,r,z);
+    }
+    // crosshair, inverted so it shows on walls and sprites alike
+    for(int i=-2;i<=2;i++){ px_inv(cross_x+i, cross_y); if(i) px_inv(cross_x, cross_y+i); }
+#else
+    // draw crosshair
     for(int i=-2;i<=2;i++){ px(cross_x+i, cross_y,1); px(cross_x, cross_y+i,1); }
     // draw enemies
-    for(int i=0;i<Ec;i++) if(E[i].live){
-        int ex=E[i].x, r=(int)E[i].s;
-        if(E[i].k==SQUARE){
-            for(int yy=H/2-r;yy<=H/2+r;yy++)
-                for(int xx=ex-r;xx<=ex+r;xx++) px(xx,yy,1);
-        } else {
-            for(int yy=-r;yy<=r;yy++) for(int xx=-r;xx<=r;xx++)
-                if(xx*xx+yy*yy<=r*r) px(ex+xx,H/2+yy,1);
-        }
+    fx_t back = (fx_t)(((int64_t)PER_TICK(GROWTH) * (FX_ONE - alpha)) >> FX_SHIFT);
+    for(int i=0;i<Ec;i++){
+        fx_t s = E_s[i] - back;
+        spr_draw(E_k[i], E_x[i], fx_int(s < START_SZ ? START_SZ : s), 0);
     }
+#endif
     // draw timer at bottom
     char tbuf[6];
     snprintf(tbuf, sizeof tbuf, "%2d", seconds_left);
     dstr((W - strlen(tbuf)*8)/2, H-8, tbuf);
-    oled_refresh();
+    cyc_render += cyc_since(c0);
+    trace_span(TR_RENDER, t0);
+    oled_present();
 }
+// Kills the biggest (nearest) enemy under the crosshair; slots are not in
+// spawn order once enemies have been despawned.
 static void shoot(void){
+    int best=-1, best_r=0;
     for(int i=0;i<Ec;i++){
-        if(!E[i].live) continue;
-        int ex=E[i].x, r=(int)E[i].s;
-        bool hit=false;
-        if(E[i].k==SQUARE){
-            if(abs(ex-cross_x)<=r && abs(H/2-cross_y)<=r) hit=true;
-        } else {
-            int dx=cross_x-ex, dy=cross_y-(H/2);
-            if(dx*dx+dy*dy<=r*r) hit=true;
-        }
-        if(hit){E[i].live=0;break;}
+#if DOOM_RAYCAST
+        fx_t z; int ex, r;
+        if(!enemy_view(i,&z,&ex,&r) || z>=zbuf[cross_x]) continue;    // behind a wall
+#else
+        int ex=E_x[i], r=fx_int(E_s[i]);
+#endif
+        if(spr_hit(E_k[i],ex,r,cross_x,cross_y) && (best<0 || r>best_r)){ best=i; best_r=r; }
     }
+    if(best>=0) despawn(best);
+}
+
+// ─────────── Simulation tick ─────────────────────────────────────────────────
+enum { PLAYING, WON, DIED };
+static uint32_t sim_ms, last_spawn;      // simulated time since GO!
+static bool     fire;                    // shot latched by the frame loop
+
+static int sim_tick(void){
+    TRACE_SCOPE(TR_SIM);
+    sim_ms += SIM_TICK_MS;
+#if DOOM_STRESS
+    // population ramps linearly to MAX_E over the run
+    while(Ec < (int)((uint64_t)MAX_E * sim_ms / SURVIVE_MS) && spawn()) { }
+#else
+    if(sim_ms - last_spawn >= SPAWN_MS){ spawn(); last_spawn = sim_ms; }
+#endif
+    if(sim_ms >= SURVIVE_MS) return WON;
+    seconds_left = (SURVIVE_MS - sim_ms + 999) / 1000;
+    input_us = time_us_32();
+    uint32_t c0=cyc_now(); update_crosshair(); cyc_cross+=cyc_since(c0);
+    if(fire){ shoot(); fire=false; }
+    c0=cyc_now(); int died=update(); cyc_update+=cyc_since(c0);
+    return died ? DIED : PLAYING;
 }
 
 // ─────────── Button helpers ──────────────────────────────────────────────────
 static void wait_for_press(void){
-    while(gpio_get(BTN_PIN)) sleep_ms(2);
+    while(replay_gpio_get(BTN_PIN)){ trace_poll(); sleep_ms(2); }   // dumps between games
     sleep_ms(20);
-    while(!gpio_get(BTN_PIN)) sleep_ms(2);
+    while(!replay_gpio_get(BTN_PIN)) sleep_ms(2);
     sleep_ms(20);
 }
 
@@ -216,40 +1029,86 @@ static void hw_once(void){
     gpio_set_function(16,GPIO_FUNC_I2C);
     gpio_set_function(17,GPIO_FUNC_I2C);
     gpio_pull_up(16); gpio_pull_up(17);
-    i2c_init(i2c_default,100000);
-    adc_init(); adc_gpio_init(26); adc_gpio_init(27);
+    i2c_init(i2c_default,i2c_rates[0]);
+    joy_init(0x3);                                  // ADC0 = X, ADC1 = Y
     gpio_init(BTN_PIN); gpio_set_dir(BTN_PIN,GPIO_IN); gpio_pull_up(BTN_PIN);
 }
 
 // ─────────── Main loop ───────────────────────────────────────────────────────
 int main(void){
-    hw_once(); oled_init();
+    hw_once(); replay_init(); oled_init(); cyc_init(); trace_init();
+#if DOOM_RAYCAST
+    ray_init();
+#endif
+    spr_init();
+#if DOOM_DUAL_CORE
+    multicore_launch_core1(core1_presenter);
+#else
+    oled_dma_init();
+#endif
     while(true){
         framed("PRESS TO START"); wait_for_press();
         for(int i=3;i>0;i--){ char d[2]={(char)('0'+i),'\0'}; framed(d); sleep_ms(500); }
         framed("GO!"); sleep_ms(400);
-        adc_select_input(0); center_x_raw=adc_read();
-        adc_select_input(1); center_y_raw=adc_read();
-        cross_x = W/2; cross_y = H/2;
-        Ec=0; memset(E,0,sizeof E); srand(time_us_32());
-        uint32_t start_ms = time_us_32()/1000;
-        uint32_t last_spawn = start_ms; int prev=1;
-        while(true){
-            uint32_t now_ms = time_us_32()/1000;
-            // spawn
-            if(now_ms - last_spawn >= SPAWN_MS){ spawn(); last_spawn = now_ms; }
-            // timer & win check
-            uint32_t elapsed = now_ms - start_ms;
-            if(elapsed >= SURVIVE_MS){ framed("YOU WON!"); sleep_ms(2000); break; }
-            seconds_left = (SURVIVE_MS - elapsed + 999) / 1000;
-            // input & shooting
-            int b = gpio_get(BTN_PIN);
-            if(!b && prev) shoot();
+        joy_recenter();                             // then it tracks drift itself
+        cross_x = W/2; cross_y = H/2; cross_fx = FX(W/2); cross_fy = FX(H/2);
+        Ec=0;
+#if DOOM_RAYCAST
+        pl_x = PL_START_X; pl_y = PL_START_Y; pl_a = (uint32_t)PL_START_A << FX_SHIFT;
+        view_dx = fcos(PL_START_A); view_dy = fsin(PL_START_A);
+        memset(zbuf, 0, sizeof zbuf);
+#endif
+        sim_ms = 0; last_spawn = 0; fire = false; seconds_left = SURVIVE_MS/1000;
+        uint32_t prev_us = time_us_32(), acc_us = 0, drawn_us = prev_us; int prev=1, state=PLAYING;
+        input_us = prev_us;                         // frames before the first tick show the start
+        uint32_t last_rep = prev_us/1000, tx_sum = 0, xf_sum = 0, frames = 0, ticks = 0;
+        uint32_t pres0 = frames_landed, lat0 = lat_sum, latn0 = lat_n;
+        while(state == PLAYING){
+            uint32_t now_us = time_us_32();
+            acc_us += now_us - prev_us; prev_us = now_us;
+            if(acc_us > MAX_CATCHUP*SIM_TICK_US) acc_us = MAX_CATCHUP*SIM_TICK_US;
+            // input: latch the press edge, the next tick consumes it
+            int b = replay_gpio_get(BTN_PIN);
+            if(!b && prev) fire = true;
             prev = b;
-            // collision check
-            if(update()){ framed("YOU DIED!"); sleep_ms(2000); break; }
-            // render
-            render_world(); sleep_ms(5);
+            // simulate whole ticks, then draw what's left as interpolation
+            int ran = 0;
+            while(acc_us >= SIM_TICK_US && state == PLAYING){
+                acc_us -= SIM_TICK_US; state = sim_tick(); ticks++; ran++;
+            }
+            if(!ran && now_us - drawn_us < DRAW_US){         // nothing new to draw yet
+                uint32_t to_draw = DRAW_US - (now_us - drawn_us), to_tick = SIM_TICK_US - acc_us;
+                sleep_us(to_draw < to_tick ? to_draw : to_tick);
+                continue;
+            }
+            drawn_us = now_us;
+            if(state == WON){ framed("YOU WON!");  sleep_ms(2000); break; }
+            if(state == DIED){ framed("YOU DIED!"); sleep_ms(2000); break; }
+            render_world((fx_t)(((uint64_t)acc_us << FX_SHIFT) / SIM_TICK_US));
+            tx_sum += oled_frame_tx; xf_sum += oled_frame_xfers; frames++;
+            trace_add(TC_I2C_BYTES, oled_frame_tx); trace_add(TC_I2C_XFERS, oled_frame_xfers);
+            trace_frame();
+            uint32_t now_ms = now_us/1000;
+            if(now_ms - last_rep >= 1000 && ticks){
+                printf("oled: %lu B/frame in %lu xfers (%lu frames, %lu ticks, full=%d)\n",
+                       (unsigned long)(tx_sum/frames), (unsigned long)(xf_sum/frames),
+                       (unsigned long)frames, (unsigned long)ticks, FB_LEN+10);
+                printf("cyc/tick: update %lu  update_crosshair %lu  render/frame %lu  enemies %d\n",
+                       (unsigned long)(cyc_update/ticks), (unsigned long)(cyc_cross/ticks),
+                       (unsigned long)(cyc_render/frames), Ec);
+                uint32_t pres = frames_landed, lat = lat_sum, latn = lat_n;
+                printf("present: %lu fps, input->photon %lu us (%s)\n",
+                       (unsigned long)(pres - pres0),
+                       (unsigned long)(latn != latn0 ? (lat - lat0)/(latn - latn0) : 0),
+                       DOOM_DUAL_CORE ? "dual-core" : "single-core DMA");
+                printf("i2c: %lu kHz, %lu retries, %lu recoveries (%lu NAK, %lu timeout)\n",
+                       (unsigned long)(i2c_rates[i2c_rate]/1000), (unsigned long)i2c_retries,
+                       (unsigned long)i2c_recoveries, (unsigned long)i2c_naks,
+                       (unsigned long)i2c_timeouts);
+                pres0 = pres; lat0 = lat; latn0 = latn;
+                last_rep = now_ms; tx_sum = 0; xf_sum = 0; frames = 0; ticks = 0;
+                cyc_update = 0; cyc_cross = 0; cyc_render = 0;
+            }
         }
         sleep_ms(250);
     }
@@ -0,0 +1,19 @@
+// generated by tools/chart_compile.c from charts/demo.chart – do not edit
+// "Demo Beat": 58 notes in 50 records, 173 bytes, 27.651 s
+static const uint8_t chart_demo[] = {
+    0x44, 0x43, 0x01, 0x44, 0x65, 0x6d, 0x6f, 0x20, 0x42, 0x65, 0x61, 0x74,
+    0x00, 0xd0, 0x0f, 0x01, 0xd8, 0x04, 0x02, 0xd8, 0x04, 0x04, 0xd8, 0x04,
+    0x08, 0xd8, 0x04, 0x01, 0xd8, 0x04, 0x02, 0xd8, 0x04, 0x04, 0xd8, 0x04,
+    0x08, 0xd8, 0x04, 0x01, 0xd8, 0x04, 0x04, 0xd8, 0x04, 0x02, 0xd8, 0x04,
+    0x08, 0xd8, 0x04, 0x01, 0xac, 0x02, 0x04, 0xac, 0x02, 0x01, 0xac, 0x02,
+    0x04, 0xac, 0x02, 0x02, 0xac, 0x02, 0x08, 0xac, 0x02, 0x02, 0xac, 0x02,
+    0x08, 0xac, 0x02, 0x05, 0xb0, 0x09, 0x06, 0xb0, 0x09, 0x11, 0xb0, 0x09,
+    0x88, 0x0e, 0x08, 0xd8, 0x04, 0x02, 0xd8, 0x04, 0x04, 0xd8, 0x04, 0x01,
+    0xe7, 0x01, 0x02, 0xe7, 0x01, 0x04, 0xe6, 0x01, 0x08, 0xe7, 0x01, 0x04,
+    0xe7, 0x01, 0x02, 0xe7, 0x01, 0x01, 0xcd, 0x03, 0x09, 0xce, 0x03, 0x06,
+    0xcd, 0x03, 0x09, 0xce, 0x03, 0x06, 0xcd, 0x03, 0x12, 0x9b, 0x07, 0x9b,
+    0x07, 0x08, 0xe7, 0x01, 0x04, 0xe7, 0x01, 0x01, 0xcd, 0x03, 0x14, 0x9c,
+    0x07, 0xe7, 0x01, 0x01, 0xce, 0x03, 0x08, 0xb4, 0x05, 0x09, 0xce, 0x03,
+    0x01, 0x9a, 0x05, 0x04, 0x9b, 0x05, 0x02, 0x9b, 0x05, 0x08, 0x9a, 0x05,
+    0x19, 0xd0, 0x0f, 0x00, 0x00,
+};
@@ -0,0 +1,96 @@
+// -----------------------------------------------------------------------------
+// ddr_chart.h  – step charts for DDR_v3: compact byte format + streaming reader
+//   • charts are const byte arrays, so they stay in flash (XIP) and only the
+//     reader's few words live in RAM, however long the song
+//   • tools/chart_compile.c turns a text chart (bpm, holds, jumps) into one
+//   • the random rounds are the same reader with a generator behind it
+//     (CHART_RAND(), rand() unless the game defines its own)
+//
+//   header   'D' 'C' CHART_VERSION, title (NUL-terminated, ≤ 16 chars)
+//   record   delta   varint, ms since the previous record (7 bits a byte,
+//                    low first, top bit = more)
+//            lanes   byte: bit 0..3 LEFT UP RIGHT DOWN, bit 4 CHART_HOLD
+//            [hold]  varint, hold length in ms, only with CHART_HOLD
+//   end      a record whose lanes are 0
+// -----------------------------------------------------------------------------
+#ifndef DDR_CHART_H
+#define DDR_CHART_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef CHART_RAND
+#define CHART_RAND()  rand()
+#endif
+
+#define CHART_VERSION 1
+#define CHART_LANES   0x0F
+#define CHART_HOLD    0x10
+
+typedef struct {
+    uint32_t t_ms;             // from the start of the chart
+    uint8_t  lanes;            // lane bitmask; two or more is a jump
+    uint32_t hold_ms;          // 0 for a tap
+} ChartNote;
+
+typedef struct {
+    const uint8_t *p;          // next record; NULL when generating
+    const char *title;
+    uint32_t t_ms;
+    uint32_t left, gap_ms;     // generator: notes still to make, spacing
+} ChartReader;
+
+static inline uint32_t chart_varint(const uint8_t **p)
+{
+    uint32_t v = 0;
+    for (int sh = 0; sh < 32; sh += 7) {
+        uint8_t b = *(*p)++;
+        v |= (uint32_t)(b & 0x7F) << sh;
+        if (!(b & 0x80)) break;
+    }
+    return v;
+}
+
+// False (and an empty chart) if the bytes are not a chart this reader knows.
+static inline bool chart_open(ChartReader *r, const uint8_t *chart)
+{
+    *r = (ChartReader){ 0 };
+    if (chart[0] != 'D' || chart[1] != 'C' || chart[2] != CHART_VERSION) {
+        r->title = "?";
+        return false;
+    }
+    r->title = (const char *)chart + 3;
+    r->p = chart + 3 + strlen(r->title) + 1;
+    return true;
+}
+
+// `n` single taps on random lanes, one every `gap_ms`, the first after one gap.
+static inline void chart_random(ChartReader *r, uint32_t n, uint32_t gap_ms)
+{
+    *r = (ChartReader){ .title = "Random", .left = n, .gap_ms = gap_ms };
+}
+
+// Next note in time order; false once the chart has ended.
+static inline bool chart_next(ChartReader *r, ChartNote *n)
+{
+    if (!r->p) {
+        if (!r->left) return false;
+        r->left--;
+        r->t_ms += r->gap_ms;
+        *n = (ChartNote){ r->t_ms, (uint8_t)(1u << (CHART_RAND() % 4)), 0 };
+        return true;
+    }
+    const uint8_t *p = r->p;
+    uint32_t dt = chart_varint(&p);
+    uint8_t lanes = *p++;
+    if (!(lanes & CHART_LANES)) return false;    // end record: stay on it
+    r->p = p;
+    r->t_ms += dt;
+    *n = (ChartNote){ r->t_ms, lanes & CHART_LANES,
+                      lanes & CHART_HOLD ? chart_varint(&r->p) : 0 };
+    return true;
+}
+
+#endif
@@ -0,0 +1,1019 @@
+// -----------------------------------------------------------------------------
+// hal.c  – Pico SDK shim for running the games headless on a Linux host
+//   • virtual clock: advances only on sleeps, polls and modelled bus time,
+//     so a game runs as fast as the host CPU allows
+//   • two cooperative "cores" (ucontext) for multicore builds
+//   • device models fed by I²C / PIO / DMA traffic:
+//       SSD1306 @0x3C  → GDDRAM, dumped as PBM
+//       PCF8574+HD44780 @0x27 → DDRAM/CGRAM, dumped as text
+//       WS2812 on any PIO state machine → latched LED frames
+//   • scripted inputs from $HAL_SCRIPT (see below), run limit $HAL_LIMIT_MS
+//   • console input: the file $HAL_STDIN is typed at 0 ms (e.g. a replay
+//     dump), then `key` lines; get_rand_32() is seeded from $HAL_SEED
+//
+// Script lines:  <ms> gpio <pin> <0|1>
+//                <ms> press <pin> <hold_ms>      (active-low button)
+//                <ms> bounce <pin> <hold_ms>     (press with contact chatter)
+//                <ms> adc <ch> <value>
+//                <ms> noise <ch> <amplitude>     (± uniform noise on that input)
+//                <ms> i2c <bus> nak <n> [after <k>] (next n transactions
+//                                                 unacknowledged, k acked first)
+//                <ms> i2c <bus> hang             (a slave holds SDA low until SCL
+//                                                 is clocked by hand)
+//                <ms> dump <tag>                 (OLED PBM + LCD + LEDs)
+//                <ms> key <chars>                (typed on the stdio console)
+//                <ms> end
+// -----------------------------------------------------------------------------
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <ucontext.h>
+#include "pico_host.h"
+
+#define NEVER        UINT64_MAX
+#define NUM_GPIO     30
+#define NUM_DMA      12
+#define WS_WORD_US   30          // 24 bits at 800 kHz
+#define WS_RESET_US  50          // line low this long → LEDs latch
+#define WS_MAX_LEDS  1024
+#define SYS_HZ       125000000u
+
+// ─────────── Virtual clock & cores ──────────────────────────────────────────
+static uint64_t now_us;
+static bool     in_event, irq_off;
+
+typedef struct { ucontext_t ctx; uint64_t wake; bool live; } core_t;
+static core_t cores[2] = { [0] = { .live = true } };
+static int    cur;
+static void (*core1_entry)(void);
+
+systick_hw_t host_systick;
+
+static void set_now(uint64_t t)
+{
+    now_us = t;
+    host_systick.cvr = (0u - (uint32_t)(t * (SYS_HZ/1000000))) & 0x00FFFFFFu;
+}
+
+// ─────────── Timed events ───────────────────────────────────────────────────
+typedef struct { uint64_t t; void (*fn)(void *); void *arg; } event_t;
+#define MAX_EVENTS 1024                 // a whole DDR song script fits
+static event_t events[MAX_EVENTS];
+static int     n_events;
+
+static void hal_at(uint64_t t, void (*fn)(void *), void *arg)
+{
+    if (n_events == MAX_EVENTS) { fprintf(stderr, "hal: event queue full\n"); exit(2); }
+    events[n_events++] = (event_t){ t, fn, arg };
+}
+static int next_event(void)
+{
+    int best = -1;
+    for (int i = 0; i < n_events; i++)
+        if (best < 0 || events[i].t < events[best].t) best = i;
+    return best;
+}
+static void run_event(int i)
+{
+    event_t e = events[i];
+    events[i] = events[--n_events];
+    if (e.t > now_us) set_now(e.t);
+    in_event = true;
+    e.fn(e.arg);
+    in_event = false;
+}
+
+static int pick_core(void)
+{
+    int other = cur ^ 1;
+    if (cores[other].live && cores[other].wake <= cores[cur].wake) return other;
+    return cur;
+}
+
+// Block the calling core until virtual time t (NEVER = until woken), running
+// events and the other core in time order meanwhile.
+static void hal_wait_until(uint64_t t)
+{
+    cores[cur].wake = t;
+    for (;;) {
+        int n = pick_core(), e = next_event();
+        uint64_t w = cores[n].wake;
+        if (e >= 0 && events[e].t <= w) { run_event(e); continue; }
+        if (w == NEVER) { fprintf(stderr, "hal: deadlock at %llu us\n", (unsigned long long)now_us); exit(3); }
+        if (w > now_us) set_now(w);
+        if (n == cur) return;
+        int me = cur; cur = n;
+        swapcontext(&cores[me].ctx, &cores[n].ctx);
+        return;
+    }
+}
+static void hal_wake(int core) { if (cores[core].wake == NEVER) cores[core].wake = now_us; }
+
+// Polling costs 1 µs of virtual time; inside IRQs the clock stands still.
+static void hal_spin(void)
+{
+    if (in_event || irq_off) return;
+    hal_wait_until(now_us + 1);
+}
+
+static void core1_trampoline(void) { core1_entry(); cores[1].live = false; hal_wait_until(NEVER); }
+
+void multicore_launch_core1(void (*entry)(void))
+{
+    static char stack[1 << 18];
+    core1_entry = entry;
+    getcontext(&cores[1].ctx);
+    cores[1].ctx.uc_stack.ss_sp = stack;
+    cores[1].ctx.uc_stack.ss_size = sizeof stack;
+    cores[1].ctx.uc_link = NULL;
+    makecontext(&cores[1].ctx, core1_trampoline, 0);
+    cores[1].live = true;
+    cores[1].wake = now_us;
+}
+uint get_core_num(void) { return (uint)cur; }
+
+// inter-core FIFOs: fifo[n] is read by core n
+static struct { uint32_t q[8]; int head, count; } fifo[2];
+
+void multicore_fifo_push_blocking(uint32_t v)
+{
+    int to = cur ^ 1;
+    while (fifo[to].count == 8) hal_wait_until(now_us + 1);
+    fifo[to].q[(fifo[to].head + fifo[to].count++) & 7] = v;
+    hal_wake(to);
+}
+uint32_t multicore_fifo_pop_blocking(void)
+{
+    while (!fifo[cur].count) hal_wait_until(NEVER);
+    uint32_t v = fifo[cur].q[fifo[cur].head];
+    fifo[cur].head = (fifo[cur].head + 1) & 7; fifo[cur].count--;
+    return v;
+}
+bool multicore_fifo_rvalid(void) { return fifo[cur].count != 0; }
+bool multicore_fifo_wready(void) { return fifo[cur ^ 1].count < 8; }
+
+// ─────────── Time API / console ─────────────────────────────────────────────
+#define STDIN_Q (1 << 18)                // room for a whole replay dump
+static char stdin_q[STDIN_Q];
+static int  stdin_head, stdin_count;
+
+bool     stdio_init_all(void) { setvbuf(stdout, NULL, _IOLBF, 0); return true; }
+int getchar_timeout_us(uint32_t timeout_us)
+{
+    if (!stdin_count && timeout_us) hal_wait_until(now_us + timeout_us); else hal_spin();
+    if (!stdin_count) return PICO_ERROR_TIMEOUT;
+    char c = stdin_q[stdin_head++ & (STDIN_Q - 1)]; stdin_count--;
+    return (unsigned char)c;
+}
+static void stdin_put(const char *s, size_t n)
+{
+    for (; n && stdin_count < STDIN_Q; n--) stdin_q[(stdin_head + stdin_count++) & (STDIN_Q - 1)] = *s++;
+}
+static void load_stdin(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) { fprintf(stderr, "hal: %s: %s\n", path, strerror(errno)); exit(2); }
+    char buf[4096]; size_t n;
+    while ((n = fread(buf, 1, sizeof buf, f)) > 0) stdin_put(buf, n);
+    if (!feof(f) || stdin_count == STDIN_Q) fprintf(stderr, "hal: %s: console input cut short\n", path);
+    fclose(f);
+}
+static uint32_t rand_state = 0x2545F491u;
+uint32_t get_rand_32(void)
+{
+    uint32_t x = rand_state;                 // xorshift32: the same on every run
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    return rand_state = x;
+}
+uint64_t time_us_64(void)     { hal_spin(); return now_us; }
+uint32_t time_us_32(void)     { return (uint32_t)time_us_64(); }
+void sleep_until(absolute_time_t t) { if (t > now_us) hal_wait_until(t); else hal_spin(); }
+void sleep_us(uint64_t us)    { sleep_until(now_us + us); }
+void sleep_ms(uint32_t ms)    { sleep_until(now_us + 1000ull * ms); }
+void tight_loop_contents(void){ hal_spin(); }
+void __wfe(void)              { hal_spin(); }
+void __sev(void)              { }
+void __dmb(void)              { }
+
+// ─────────── Interrupts ─────────────────────────────────────────────────────
+static irq_handler_t irq_handlers[HOST_NUM_IRQS];
+static bool          irq_enabled[HOST_NUM_IRQS], irq_pending[HOST_NUM_IRQS];
+
+void irq_set_exclusive_handler(uint num, irq_handler_t h) { irq_handlers[num] = h; }
+void irq_set_enabled(uint num, bool on) { irq_enabled[num] = on; }
+
+static void irq_raise(uint num)
+{
+    if (!irq_enabled[num] || !irq_handlers[num]) return;
+    if (irq_off) { irq_pending[num] = true; return; }
+    bool was = in_event; in_event = true;
+    irq_handlers[num]();
+    in_event = was;
+}
+uint32_t save_and_disable_interrupts(void) { uint32_t s = irq_off; irq_off = true; return s; }
+void restore_interrupts(uint32_t s)
+{
+    irq_off = s;
+    if (irq_off) return;
+    for (uint i = 0; i < HOST_NUM_IRQS; i++)
+        if (irq_pending[i]) { irq_pending[i] = false; irq_raise(i); }
+}
+
+int spin_lock_claim_unused(bool required) { static int next = 16; (void)required; return next++; }
+spin_lock_t *spin_lock_init(uint lock_num)
+{
+    static spin_lock_t locks[32];
+    locks[lock_num & 31] = 0;
+    return &locks[lock_num & 31];
+}
+
+// ─────────── Alarms (default pool on TIMER_IRQ_3) ───────────────────────────
+#define MAX_ALARMS 16
+static struct { uint64_t t; alarm_callback_t cb; void *user; bool live, due; } alarms[MAX_ALARMS];
+static uint32_t alarm_gen[MAX_ALARMS];
+
+static void ev_alarm(void *a)
+{
+    uintptr_t v = (uintptr_t)a; int i = v & 0xFF;
+    if (!alarms[i].live || alarm_gen[i] != (v >> 8)) return;   // cancelled or re-armed
+    alarms[i].due = true;
+    irq_raise(TIMER_IRQ_3);
+}
+
+static void alarm_dispatch(void)
+{
+    for (int i = 0; i < MAX_ALARMS; i++) {
+        if (!alarms[i].live || !alarms[i].due) continue;
+        alarms[i].due = false;
+        int64_t again = alarms[i].cb(i + 1, alarms[i].user);
+        if (!alarms[i].live || alarms[i].due) continue;       // cancelled / re-armed meanwhile
+        if (!again) { alarms[i].live = false; continue; }
+        alarms[i].t = again > 0 ? alarms[i].t + again : now_us - again;
+        hal_at(alarms[i].t, ev_alarm, (void *)(uintptr_t)(i | ++alarm_gen[i] << 8));
+    }
+}
+alarm_id_t add_alarm_at(absolute_time_t t, alarm_callback_t cb, void *user, bool fire_if_past)
+{
+    int i = 0;
+    while (i < MAX_ALARMS && alarms[i].live) i++;
+    if (i == MAX_ALARMS) return -1;
+    irq_set_exclusive_handler(TIMER_IRQ_3, alarm_dispatch);
+    irq_set_enabled(TIMER_IRQ_3, true);
+    if (t <= now_us && !fire_if_past) return 0;
+    alarms[i] = (typeof(alarms[0])){ t > now_us ? t : now_us, cb, user, true, false };
+    hal_at(alarms[i].t, ev_alarm, (void *)(uintptr_t)(i | ++alarm_gen[i] << 8));
+    return i + 1;
+}
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t cb, void *user, bool fire_if_past)
+{ return add_alarm_at(now_us + us, cb, user, fire_if_past); }
+alarm_id_t add_alarm_in_ms(uint32_t ms, alarm_callback_t cb, void *user, bool fire_if_past)
+{ return add_alarm_at(now_us + 1000ull * ms, cb, user, fire_if_past); }
+bool cancel_alarm(alarm_id_t id)
+{
+    if (id <= 0 || id > MAX_ALARMS || !alarms[id - 1].live) return false;
+    alarms[id - 1].live = false;
+    return true;
+}
+
+// Wait for interrupt: sleep until the next event (which may raise one).
+// Free-running ADC DMA only moves data and never wakes the core.
+static void ev_adc_dma(void *arg);
+void __wfi(void)
+{
+    uint64_t t = NEVER;
+    for (int i = 0; i < n_events; i++)
+        if (events[i].fn != ev_adc_dma && events[i].t < t) t = events[i].t;
+    hal_wait_until(t != NEVER ? t : now_us + 1);
+}
+
+// ─────────── GPIO / ADC ─────────────────────────────────────────────────────
+static int8_t   gpio_drive[NUM_GPIO];           // -1 = not driven externally
+static bool     gpio_pull[NUM_GPIO], gpio_out[NUM_GPIO];
+static uint8_t  gpio_fn[NUM_GPIO];
+static bool i2c_sda_held(uint pin);
+static void i2c_scl_rise(uint pin);
+static uint16_t adc_val[5] = { 2048, 2048, 2048, 2048, 2048 };
+static uint16_t adc_noise[5];
+static uint     adc_ch;
+
+void gpio_init(uint pin)                { gpio_out[pin] = false; gpio_fn[pin] = GPIO_FUNC_SIO; }
+void gpio_set_dir(uint pin, bool out)   { (void)pin; (void)out; }
+void gpio_pull_up(uint pin)             { gpio_pull[pin] = true; }
+void gpio_pull_down(uint pin)           { gpio_pull[pin] = false; }
+static int8_t   pwm_out_chan[8] = { -1, -1, -1, -1, -1, -1, -1, -1 };  // pin on A / B
+void gpio_set_function(uint pin, enum gpio_function fn)
+{
+    gpio_fn[pin] = (uint8_t)fn;
+    if (fn == GPIO_FUNC_PWM) pwm_out_chan[pwm_gpio_to_slice_num(pin)] = pwm_gpio_to_channel(pin);
+}
+void gpio_put(uint pin, bool v)
+{
+    if (v && !gpio_out[pin]) i2c_scl_rise(pin);
+    gpio_out[pin] = v;
+}
+static bool gpio_level(uint pin)
+{
+    if (i2c_sda_held(pin)) return false;
+    return gpio_drive[pin] >= 0 ? gpio_drive[pin] : gpio_pull[pin];
+}
+bool gpio_get(uint pin)
+{
+    hal_spin();
+    return gpio_level(pin);
+}
+
+// Edge interrupts: latched per pin, delivered through IO_IRQ_BANK0.
+static uint32_t            gpio_irq_en[NUM_GPIO], gpio_irq_st[NUM_GPIO];
+static gpio_irq_callback_t gpio_irq_cb;
+
+static void gpio_irq_dispatch(void)
+{
+    for (uint pin = 0; pin < NUM_GPIO; pin++) {
+        uint32_t ev = gpio_irq_st[pin] & gpio_irq_en[pin];
+        if (!ev) continue;
+        gpio_irq_st[pin] &= ~ev;
+        if (gpio_irq_cb) gpio_irq_cb(pin, ev);
+    }
+}
+void gpio_set_irq_enabled(uint pin, uint32_t events, bool on)
+{
+    if (on) gpio_irq_en[pin] |= events; else gpio_irq_en[pin] &= ~events;
+}
+void gpio_set_irq_enabled_with_callback(uint pin, uint32_t events, bool on, gpio_irq_callback_t cb)
+{
+    gpio_set_irq_enabled(pin, events, on);
+    gpio_irq_cb = cb;
+    irq_set_exclusive_handler(IO_IRQ_BANK0, gpio_irq_dispatch);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+}
+static void gpio_drive_pin(uint pin, int8_t v)
+{
+    bool was = gpio_level(pin);
+    gpio_drive[pin] = v;
+    bool now = gpio_level(pin);
+    if (was == now) return;
+    gpio_irq_st[pin] |= now ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL;
+    if (gpio_irq_st[pin] & gpio_irq_en[pin]) irq_raise(IO_IRQ_BANK0);
+}
+
+void     adc_init(void)            { }
+void     adc_gpio_init(uint pin)   { (void)pin; }
+void     adc_select_input(uint ch) { adc_ch = ch; }
+static uint16_t adc_convert(void)
+{
+    static uint32_t seed = 1;
+    int v = adc_val[adc_ch];
+    if (adc_noise[adc_ch]) {
+        seed = seed * 1664525u + 1013904223u;
+        v += (int)((seed >> 8) % (2u * adc_noise[adc_ch] + 1)) - adc_noise[adc_ch];
+    }
+    return (uint16_t)(v < 0 ? 0 : v > 4095 ? 4095 : v);
+}
+uint16_t adc_read(void)            { sleep_us(2); return adc_convert(); }
+
+adc_hw_t host_adc;
+static uint adc_rr, adc_cycles = 96;
+static bool adc_running;
+void adc_set_round_robin(uint mask) { adc_rr = mask & 0x1F; }
+void adc_set_clkdiv(float div)      { adc_cycles = div < 96 ? 96 : (uint)div + 1; }
+void adc_fifo_setup(bool en, bool dreq_en, uint16_t th, bool err, bool shift)
+{ (void)en; (void)dreq_en; (void)th; (void)err; (void)shift; }
+void adc_fifo_drain(void)           { }
+void adc_run(bool run)              { adc_running = run; }
+// next input after a conversion, in round-robin order
+static void adc_advance(void)
+{
+    if (!adc_rr) return;
+    do adc_ch = (adc_ch + 1) % 5; while (!(adc_rr & (1u << adc_ch)));
+}
+
+uint32_t clock_get_hz(enum clock_index clk) { (void)clk; return SYS_HZ; }
+
+// ─────────── SSD1306 model ──────────────────────────────────────────────────
+static struct {
+    uint8_t  ram[8][128];
+    int      col, page, c0, c1, p0, p1;
+    uint8_t  cmd[4]; int ncmd, need;
+    uint32_t bytes, xfers, data_bytes;
+} oledm = { .c1 = 127, .p1 = 7 };
+
+static int ssd_args(uint8_t c)
+{
+    switch (c) {
+    case 0x21: case 0x22: return 2;
+    case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3:
+    case 0xD5: case 0xD9: case 0xDA: case 0xDB: return 1;
+    default: return 0;
+    }
+}
+static void ssd_cmd_byte(uint8_t b)
+{
+    oledm.cmd[oledm.ncmd++] = b;
+    if (oledm.ncmd == 1) oledm.need = ssd_args(b);
+    if (oledm.ncmd <= oledm.need) return;
+    uint8_t *c = oledm.cmd;
+    if (c[0] == 0x21) { oledm.c0 = c[1] & 127; oledm.c1 = c[2] & 127; oledm.col = oledm.c0; }
+    if (c[0] == 0x22) { oledm.p0 = c[1] & 7;   oledm.p1 = c[2] & 7;   oledm.page = oledm.p0; }
+    if (c[0] >= 0xB0 && c[0] <= 0xB7) oledm.page = c[0] & 7;
+    oledm.ncmd = 0;
+}
+static void ssd_data_byte(uint8_t b)
+{
+    oledm.ram[oledm.page][oledm.col] = b;
+    oledm.data_bytes++;
+    if (++oledm.col > oledm.c1) {
+        oledm.col = oledm.c0;
+        if (++oledm.page > oledm.p1) oledm.page = oledm.p0;
+    }
+}
+static void ssd_xfer(const uint8_t *b, size_t n)
+{
+    oledm.bytes += n + 1; oledm.xfers++;
+    size_t i = 0;
+    while (i < n) {
+        uint8_t ctl = b[i++];
+        bool cont = ctl & 0x80, data = ctl & 0x40;
+        if (!cont) { for (; i < n; i++) data ? ssd_data_byte(b[i]) : ssd_cmd_byte(b[i]); break; }
+        if (i < n) { data ? ssd_data_byte(b[i]) : ssd_cmd_byte(b[i]); i++; }
+    }
+}
+
+// ─────────── PCF8574 + HD44780 model ────────────────────────────────────────
+static struct {
+    uint8_t  port, nib_hi, ddram[0x80], cgram[64];
+    bool     four_bit, half, to_cg;
+    uint8_t  addr, cg_addr;
+    uint64_t busy_until;                         // ns
+    uint32_t bytes, xfers, instr, chars, clears, too_fast;
+} lcdm;
+
+// t is when the port write lands, in ns: bytes of one transaction arrive
+// one I²C byte time apart, so packed writes are checked against exec times.
+static void lcd_exec(uint8_t v, bool rs, uint64_t t)
+{
+    uint64_t exec = 37;
+    if (rs) {
+        lcdm.chars++;
+        if (lcdm.to_cg) lcdm.cgram[lcdm.cg_addr++ & 63] = v;
+        else {
+            lcdm.ddram[lcdm.addr & 0x7F] = v;
+            lcdm.addr = lcdm.addr == 0x27 ? 0x40 : lcdm.addr == 0x67 ? 0x00 : lcdm.addr + 1;
+        }
+    } else {
+        lcdm.instr++;
+        if (v & 0x80)      { lcdm.addr = v & 0x7F; lcdm.to_cg = false; }
+        else if (v & 0x40) { lcdm.cg_addr = v & 0x3F; lcdm.to_cg = true; }
+        else if (v & 0x20) { lcdm.four_bit = !(v & 0x10); lcdm.half = false; }
+        else if (v & 0x1C) { }                  // shift / display / entry mode
+        else if (v & 0x02) { lcdm.addr = 0; lcdm.to_cg = false; exec = 1520; }
+        else if (v & 0x01) { memset(lcdm.ddram, ' ', sizeof lcdm.ddram); lcdm.addr = 0;
+                             lcdm.to_cg = false; lcdm.clears++; exec = 1520; }
+    }
+    lcdm.busy_until = t + exec * 1000;
+}
+static void lcd_port(uint8_t p, uint64_t t)
+{
+    bool fall = (lcdm.port & 0x04) && !(p & 0x04);
+    if (fall) {
+        uint8_t nib = lcdm.port & 0xF0;
+        bool rs = lcdm.port & 0x01;
+        if (!lcdm.half && t < lcdm.busy_until) lcdm.too_fast++;   // first latch of one
+        if (!lcdm.four_bit) lcd_exec(nib, rs, t);
+        else if (!lcdm.half) { lcdm.nib_hi = nib; lcdm.half = true; }
+        else { lcdm.half = false; lcd_exec(lcdm.nib_hi | (nib >> 4), rs, t); }
+    }
+    lcdm.port = p;
+}
+static void lcd_xfer(const uint8_t *b, size_t n, uint64_t t0, uint64_t byte_ns)
+{
+    lcdm.bytes += n + 1; lcdm.xfers++;
+    for (size_t i = 0; i < n; i++) lcd_port(b[i], t0 + (i + 2) * byte_ns);
+}
+static void lcd_text(char out[2][17])
+{
+    static const char arrows[] = "<^>v????";
+    for (int r = 0; r < 2; r++) {
+        for (int c = 0; c < 16; c++) {
+            uint8_t v = lcdm.ddram[(r ? 0x40 : 0) + c];
+            out[r][c] = v < 8 ? arrows[v] : (v >= 32 && v < 127) ? (char)v : '.';
+        }
+        out[r][16] = 0;
+    }
+}
+
+// ─────────── I²C ────────────────────────────────────────────────────────────
+static i2c_hw_t i2c_hw[2];
+i2c_inst_t i2c0_inst = { &i2c_hw[0], 0, 100000 };
+i2c_inst_t i2c1_inst = { &i2c_hw[1], 1, 100000 };
+static uint64_t i2c_busy_until[2];
+
+// Injected faults: after `skip` acknowledged ones, the next `nak`
+// transactions are not (TX abort, 7-bit address NOACK); a hung bus has a slave stuck mid-byte holding
+// SDA low, so nothing completes until SCL, taken over as a GPIO, has been
+// clocked I2C_HANG_PULSES times. Bus pins: GPn with n%4 = 0/1 → I2C0
+// SDA/SCL, 2/3 → I2C1.
+#define I2C_HANG_PULSES 7
+static struct { uint nak, skip, pulses; bool hung; } i2c_fault[2];
+
+static bool i2c_sda_held(uint pin)
+{ return !(pin & 1) && gpio_fn[pin] == GPIO_FUNC_SIO && i2c_fault[(pin >> 1) & 1].hung; }
+static void i2c_scl_rise(uint pin)
+{
+    if (!(pin & 1) || gpio_fn[pin] != GPIO_FUNC_SIO) return;
+    uint b = (pin >> 1) & 1;
+    if (i2c_fault[b].hung && ++i2c_fault[b].pulses >= I2C_HANG_PULSES) i2c_fault[b].hung = false;
+}
+static bool i2c_take_nak(i2c_inst_t *i2c)
+{
+    if (!i2c_fault[i2c->idx].nak) return false;
+    if (i2c_fault[i2c->idx].skip) { i2c_fault[i2c->idx].skip--; return false; }
+    i2c_fault[i2c->idx].nak--;
+    return true;
+}
+static void i2c_abort(i2c_inst_t *i2c)
+{
+    i2c->hw->raw_intr_stat |= I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS;
+    i2c->hw->tx_abrt_source = I2C_IC_TX_ABRT_SOURCE_ABRT_7B_ADDR_NOACK_BITS;
+}
+static void ev_i2c(void *a)
+{
+    uintptr_t v = (uintptr_t)a;
+    uint b = (v >> 24) & 1;
+    if (v & 0x800000) { i2c_fault[b].hung = true; i2c_fault[b].pulses = 0; }
+    else { i2c_fault[b].nak += v & 0xFFFF; i2c_fault[b].skip = (v >> 16) & 0x7F; }
+}
+
+static uint64_t i2c_time_us(i2c_inst_t *i2c, size_t bytes)
+{ return ((uint64_t)(bytes + 1) * 9 + 2) * 1000000ull / i2c->baud; }     // + address, START/STOP
+
+// t0: virtual µs at START; the address byte goes first
+static bool i2c_deliver(i2c_inst_t *i2c, uint8_t addr, const uint8_t *b, size_t n, uint64_t t0)
+{
+    if (addr == 0x3C) { ssd_xfer(b, n); return true; }
+    if (addr == 0x27) { lcd_xfer(b, n, t0 * 1000, 9000000000ull / i2c->baud); return true; }
+    return false;
+}
+
+uint i2c_init(i2c_inst_t *i2c, uint baud)
+{
+    i2c->hw->raw_intr_stat = 0; i2c->hw->tx_abrt_source = 0;
+    i2c->hw->intr_mask = 0; i2c->hw->status = I2C_IC_STATUS_TFE_BITS;
+    i2c->baud = baud;
+    return baud;
+}
+uint i2c_set_baudrate(i2c_inst_t *i2c, uint baud) { i2c->baud = baud; return baud; }
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop)
+{
+    (void)nostop;
+    if (i2c_fault[i2c->idx].hung) {
+        fprintf(stderr, "hal: i2c%u hung, blocking write never returns\n", i2c->idx);
+        exit(3);
+    }
+    if (i2c_busy_until[i2c->idx] > now_us) sleep_until(i2c_busy_until[i2c->idx]);
+    i2c->hw->tar = addr;
+    bool nak = i2c_take_nak(i2c);
+    if (nak) i2c_abort(i2c);
+    bool ack = !nak && i2c_deliver(i2c, addr, src, len, now_us);
+    uint64_t t = ack ? i2c_time_us(i2c, len) : i2c_time_us(i2c, 0);
+    i2c_busy_until[i2c->idx] = now_us + t;
+    sleep_until(i2c_busy_until[i2c->idx]);
+    return ack ? (int)len : PICO_ERROR_GENERIC;
+}
+int i2c_write_timeout_us(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len,
+                         bool nostop, uint timeout_us)
+{
+    if (i2c_fault[i2c->idx].hung || i2c_time_us(i2c, len) > timeout_us) {
+        sleep_us(timeout_us);
+        return PICO_ERROR_TIMEOUT;
+    }
+    return i2c_write_blocking(i2c, addr, src, len, nostop);
+}
+
+// The end of a DMA stream on the wire: STOP_DET, or TX_ABRT (bit 1 of the
+// arg) for a NAK; either way the controller is idle, the FIFO empty.
+static void ev_i2c_end(void *a)
+{
+    uintptr_t v = (uintptr_t)a;
+    i2c_inst_t *i2c = (v & 1) ? &i2c1_inst : &i2c0_inst;
+    if (v & 2) i2c_abort(i2c);
+    else i2c->hw->raw_intr_stat |= I2C_IC_RAW_INTR_STAT_STOP_DET_BITS;
+    i2c->hw->status = I2C_IC_STATUS_TFE_BITS;
+    if (i2c->hw->raw_intr_stat & i2c->hw->intr_mask) irq_raise(I2C0_IRQ + i2c->idx);
+}
+
+// data_cmd words as a DMA stream from `start`: bytes gather until a STOP
+// ends the transaction. The DMA is done once the last word is in the
+// 16-deep TX FIFO, before the wire is; returns that time, relative to
+// `start`. A NAK aborts the rest (TX_ABRT as it happens, the FIFO flushes,
+// the DMA runs dry); on a hung bus the stream never finishes (NEVER).
+#define I2C_FIFO_DEPTH 16
+static uint64_t i2c_stream(i2c_inst_t *i2c, const void *src, uint count, uint size, uint64_t start)
+{
+    static uint8_t xfer[4096];
+    size_t n = 0; uint64_t t = 0;
+    if (i2c_fault[i2c->idx].hung) return NEVER;
+    i2c->hw->raw_intr_stat = 0; i2c->hw->tx_abrt_source = 0;
+    i2c->hw->status = I2C_IC_STATUS_MST_ACTIVITY_BITS;
+    uint64_t tail = i2c_time_us(i2c, I2C_FIFO_DEPTH - 1), abort = NEVER;
+    for (uint i = 0; i < count; i++) {
+        uint32_t w = size == DMA_SIZE_32 ? ((const uint32_t *)src)[i] : ((const uint16_t *)src)[i];
+        if (n < sizeof xfer) xfer[n++] = (uint8_t)w;
+        if (w & I2C_IC_DATA_CMD_STOP_BITS) {
+            if (abort == NEVER && i2c_take_nak(i2c)) abort = t + i2c_time_us(i2c, 0);
+            if (abort == NEVER) i2c_deliver(i2c, (uint8_t)i2c->hw->tar, xfer, n, start + t);
+            t += i2c_time_us(i2c, n); n = 0;
+        }
+    }
+    uint64_t fed = t > tail ? t - tail : 0;
+    i2c_busy_until[i2c->idx] = start + (abort != NEVER ? abort : t);
+    if (abort != NEVER) {
+        hal_at(start + abort, ev_i2c_end, (void *)(uintptr_t)(i2c->idx | 2));
+        return abort < fed ? abort : fed;
+    }
+    hal_at(start + t, ev_i2c_end, (void *)(uintptr_t)i2c->idx);
+    return fed;
+}
+
+// ─────────── PIO / WS2812 model ─────────────────────────────────────────────
+pio_hw_t pio0_hw, pio1_hw;
+typedef struct {
+    uint32_t leds[WS_MAX_LEDS], frame[WS_MAX_LEDS];
+    int      n, frame_n;
+    uint64_t busy_until;
+    uint32_t words, frames;
+    int      pin;                               // side-set pin, -1 = none
+    bool     dark;                              // warned: data goes nowhere
+} strip_t;
+static strip_t  strips[2][4];
+static uint8_t  sm_claimed[2];
+static uint32_t pio_oe[2];                      // PIO-driven output enables
+
+static strip_t *strip_of(PIO pio, uint sm) { return &strips[pio == pio1][sm & 3]; }
+// The WS2812 program emits its bit stream only through side-set: the strip
+// sees it if that pin is muxed to this PIO and the PIO drives it as output.
+static bool ws_lit(const strip_t *s)
+{
+    int p = (int)(s - &strips[0][0]) / 4;
+    if (s->pin >= 0 && gpio_fn[s->pin] == GPIO_FUNC_PIO0 + p && (pio_oe[p] >> s->pin & 1)) return true;
+    if (!s->dark) fprintf(stderr, "hal: pio%d.sm%d: no side-set output pin, strip stays dark\n",
+                          p, (int)(s - &strips[p][0]));
+    return false;
+}
+static void ws_latch(strip_t *s)
+{
+    if (!s->n) return;
+    memcpy(s->frame, s->leds, sizeof s->leds[0] * s->n);
+    s->frame_n = s->n; s->n = 0; s->frames++;
+}
+static uint64_t ws_word(strip_t *s, uint32_t w, uint64_t start)
+{
+    if (start >= s->busy_until + WS_RESET_US) ws_latch(s);
+    if (!ws_lit(s)) s->dark = true;
+    else if (s->n < WS_MAX_LEDS) s->leds[s->n++] = w;
+    s->words++;
+    if (start < s->busy_until) start = s->busy_until;
+    return s->busy_until = start + WS_WORD_US;
+}
+
+uint pio_add_program(PIO pio, const pio_program_t *prog) { (void)pio; (void)prog; return 0; }
+int  pio_claim_unused_sm(PIO pio, bool required)
+{
+    uint8_t *m = &sm_claimed[pio == pio1];
+    for (int sm = 0; sm < 4; sm++) if (!(*m & (1u << sm))) { *m |= 1u << sm; return sm; }
+    if (required) { fprintf(stderr, "hal: no free state machine\n"); exit(2); }
+    return -1;
+}
+void pio_gpio_init(PIO pio, uint pin) { gpio_set_function(pin, pio == pio1 ? GPIO_FUNC_PIO1 : GPIO_FUNC_PIO0); }
+void pio_sm_init(PIO pio, uint sm, uint offset, const pio_sm_config *c)
+{
+    (void)offset;
+    strip_of(pio, sm)->pin = c->sideset_bits ? (int)c->sideset_base : -1;
+}
+void pio_sm_set_enabled(PIO pio, uint sm, bool on) { (void)pio; (void)sm; (void)on; }
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out)
+{
+    (void)sm;
+    uint32_t m = (pin_count >= 32 ? ~0u : (1u << pin_count) - 1) << pin_base;
+    if (is_out) pio_oe[pio == pio1] |= m; else pio_oe[pio == pio1] &= ~m;
+}
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data)
+{
+    strip_t *s = strip_of(pio, sm);
+    // 8-deep joined TX FIFO: block while it is full
+    if (s->busy_until > now_us + 8 * WS_WORD_US) sleep_until(s->busy_until - 8 * WS_WORD_US);
+    ws_word(s, data, now_us);
+}
+
+// ─────────── PWM audio capture ──────────────────────────────────────────────
+// Timer-paced DMA into a slice's CC is taken as a sample stream: the output
+// channel's duty becomes one unsigned 8-bit sample, gaps become silence.
+pwm_hw_t host_pwm;
+static uint8_t  *wav;
+static size_t    wav_n, wav_cap;
+static uint32_t  wav_hz;
+static uint64_t  wav_end_us;
+
+void pwm_init(uint slice, pwm_config *c, bool start)
+{
+    host_pwm.slice[slice].csr = c->csr | start;
+    host_pwm.slice[slice].div = c->div;
+    host_pwm.slice[slice].top = c->top;
+}
+static void wav_put(uint8_t v)
+{
+    if (wav_n == wav_cap) wav = realloc(wav, wav_cap = wav_cap ? 2*wav_cap : 1 << 16);
+    wav[wav_n++] = v;
+}
+static void pwm_capture(uint slice, const void *src, uint n, uint size,
+                        uint64_t start, uint64_t period_ns, uint32_t hz)
+{
+    int chan = pwm_out_chan[slice];
+    if (chan < 0) return;
+    uint32_t top = host_pwm.slice[slice].top + 1;
+    if (!wav_hz) { wav_hz = hz; wav_end_us = start; }
+    for (; wav_end_us + period_ns / 1000 <= start; wav_end_us += period_ns / 1000) wav_put(128);
+    for (uint i = 0; i < n; i++) {
+        uint32_t w = size == DMA_SIZE_32 ? ((const uint32_t *)src)[i]
+                   : size == DMA_SIZE_16 ? ((const uint16_t *)src)[i] * 0x10001u
+                   : ((const uint8_t *)src)[i] * 0x01010101u;
+        uint32_t level = chan ? w >> 16 : w & 0xFFFF;
+        wav_put(level >= top ? 255 : (uint8_t)(level * 256 / top));
+    }
+    wav_end_us = start + n * period_ns / 1000;
+}
+
+// ─────────── DMA ────────────────────────────────────────────────────────────
+static uint16_t dma_timer_num[4], dma_timer_den[4];
+static uint8_t  dma_timer_claimed;
+
+int dma_claim_unused_timer(bool required)
+{
+    for (int t = 0; t < 4; t++) if (!(dma_timer_claimed & (1u << t))) { dma_timer_claimed |= 1u << t; return t; }
+    if (required) { fprintf(stderr, "hal: no free DMA timer\n"); exit(2); }
+    return -1;
+}
+void dma_timer_set_fraction(uint timer, uint16_t num, uint16_t den)
+{ dma_timer_num[timer & 3] = num; dma_timer_den[timer & 3] = den; }
+
+static struct {
+    dma_channel_config cfg;
+    volatile void *wr; const volatile void *rd;
+    uint count, pos, left;                          // ADC streams: progress
+    bool claimed, busy, irq0_en, irq0_st;
+} dma[NUM_DMA];
+
+int dma_claim_unused_channel(bool required)
+{
+    for (int i = 0; i < NUM_DMA; i++) if (!dma[i].claimed) { dma[i].claimed = true; return i; }
+    if (required) { fprintf(stderr, "hal: no free DMA channel\n"); exit(2); }
+    return -1;
+}
+dma_channel_config dma_channel_get_default_config(uint ch)
+{ return (dma_channel_config){ DMA_SIZE_32, true, false, 0x3f, ch, 0, false }; }
+
+static void dma_start(uint ch);
+static void dma_done(void *arg);
+// ADC FIFO → memory: one transfer per conversion, for as long as the count
+// lasts, with the write address wrapping inside its ring if one is set.
+static void ev_adc_dma(void *arg)
+{
+    uint ch = (uint)(uintptr_t)arg;
+    if (!dma[ch].busy) return;
+    if (adc_running) {
+        uint32_t mask = dma[ch].cfg.ring_wr && dma[ch].cfg.ring_bits ? (1u << dma[ch].cfg.ring_bits) - 1 : ~0u;
+        uintptr_t base = (uintptr_t)dma[ch].wr & ~(uintptr_t)mask;
+        uintptr_t off = ((uintptr_t)dma[ch].wr + ((uintptr_t)dma[ch].pos << dma[ch].cfg.size)) & mask;
+        uint16_t v = adc_convert();
+        adc_advance();
+        if (dma[ch].cfg.size == DMA_SIZE_8) *(uint8_t *)(base + off) = (uint8_t)(v >> 4);
+        else *(uint16_t *)(base + off) = v;
+        dma[ch].pos++;
+        if (--dma[ch].left == 0) { dma_done(arg); return; }
+    }
+    hal_at(now_us + (adc_cycles + 47) / 48, ev_adc_dma, arg);
+}
+static void dma_done(void *arg)
+{
+    uint ch = (uint)(uintptr_t)arg;
+    dma[ch].busy = false;
+    if (dma[ch].cfg.chain_to != ch) dma_start(dma[ch].cfg.chain_to);
+    if (dma[ch].irq0_en) { dma[ch].irq0_st = true; irq_raise(DMA_IRQ_0); }
+}
+static void dma_start(uint ch)
+{
+    const void *src = (const void *)dma[ch].rd;
+    volatile void *dst = dma[ch].wr;
+    uint n = dma[ch].count, size = dma[ch].cfg.size;
+    uint64_t end = now_us;
+    dma[ch].busy = true;
+    if (src == (const void *)&host_adc.fifo) {
+        dma[ch].pos = 0; dma[ch].left = n;
+        hal_at(now_us + (adc_cycles + 47) / 48, ev_adc_dma, (void *)(uintptr_t)ch);
+        return;
+    }
+    for (int b = 0; b < 2; b++) {
+        i2c_inst_t *i2c = b ? &i2c1_inst : &i2c0_inst;
+        if (dst != &i2c->hw->data_cmd) continue;
+        uint64_t start = i2c_busy_until[b] > now_us ? i2c_busy_until[b] : now_us;
+        uint64_t fed = i2c_stream(i2c, src, n, size, start);
+        end = fed == NEVER ? NEVER : start + fed;
+    }
+    for (int p = 0; p < 2; p++) for (uint sm = 0; sm < 4; sm++) {
+        PIO pio = p ? pio1 : pio0;
+        if (dst != &pio->txf[sm]) continue;
+        strip_t *s = strip_of(pio, sm);
+        for (uint i = 0; i < n; i++) end = ws_word(s, ((const uint32_t *)src)[i], end);
+    }
+    uint t = dma[ch].cfg.dreq - dma_get_timer_dreq(0);
+    if (t < 4 && dma_timer_num[t]) {                // timer-paced, one transfer a tick
+        uint64_t period_ns = 1000000000ull * dma_timer_den[t] / ((uint64_t)dma_timer_num[t] * SYS_HZ);
+        for (uint sl = 0; sl < 8; sl++)
+            if (dst == &host_pwm.slice[sl].cc)
+                pwm_capture(sl, src, n, size, now_us, period_ns,
+                            (uint32_t)((uint64_t)SYS_HZ * dma_timer_num[t] / dma_timer_den[t]));
+        end = now_us + n * period_ns / 1000;
+    }
+    if (end == now_us && n) {                       // plain memory copy
+        size_t bytes = (size_t)n << size;
+        if (dma[ch].cfg.wr_inc && dma[ch].cfg.rd_inc) memcpy((void *)dst, src, bytes);
+    }
+    if (end != NEVER) hal_at(end, dma_done, (void *)(uintptr_t)ch);
+}
+
+void dma_channel_configure(uint ch, const dma_channel_config *c, volatile void *write_addr,
+                           const volatile void *read_addr, uint count, bool trigger)
+{
+    dma[ch].cfg = *c; dma[ch].wr = write_addr; dma[ch].rd = read_addr; dma[ch].count = count;
+    if (trigger) dma_start(ch);
+}
+void dma_channel_transfer_from_buffer_now(uint ch, const volatile void *read_addr, uint count)
+{ dma[ch].rd = read_addr; dma[ch].count = count; dma_start(ch); }
+void dma_channel_set_read_addr(uint ch, const volatile void *read_addr, bool trigger)
+{ dma[ch].rd = read_addr; if (trigger) dma_start(ch); }
+void dma_channel_start(uint ch) { dma_start(ch); }
+void dma_channel_set_trans_count(uint ch, uint count, bool trigger)
+{ dma[ch].count = count; if (trigger) dma_start(ch); }
+void dma_start_channel_mask(uint32_t mask)
+{ for (uint ch = 0; ch < NUM_DMA; ch++) if (mask & (1u << ch)) dma_start(ch); }
+bool dma_channel_is_busy(uint ch)                 { hal_spin(); return dma[ch].busy; }
+void dma_channel_wait_for_finish_blocking(uint ch){ while (dma[ch].busy) hal_wait_until(now_us + 1); }
+void dma_channel_abort(uint ch)
+{
+    for (int i = 0; i < n_events; i++)
+        if (events[i].fn == dma_done && events[i].arg == (void *)(uintptr_t)ch) events[i--] = events[--n_events];
+    dma[ch].busy = false;
+}
+void dma_channel_set_irq0_enabled(uint ch, bool on){ dma[ch].irq0_en = on; }
+void dma_channel_acknowledge_irq0(uint ch)        { dma[ch].irq0_st = false; }
+bool dma_channel_get_irq0_status(uint ch)         { return dma[ch].irq0_st; }
+
+// ─────────── Capture dumps ──────────────────────────────────────────────────
+static const char *out_dir(void) { const char *d = getenv("HAL_OUT"); return d ? d : "."; }
+
+void hal_fb_dump(const char *tag)
+{
+    char path[512];
+    snprintf(path, sizeof path, "%s/%s_%s.pbm", out_dir(), program_invocation_short_name, tag);
+    FILE *f = fopen(path, "w");
+    if (!f) { fprintf(stderr, "hal: %s: %s\n", path, strerror(errno)); return; }
+    fprintf(f, "P1\n128 64\n");
+    for (int y = 0; y < 64; y++) {
+        for (int x = 0; x < 128; x++) fputs(oledm.ram[y >> 3][x] >> (y & 7) & 1 ? "1 " : "0 ", f);
+        fputc('\n', f);
+    }
+    fclose(f);
+}
+static void dump_all(const char *tag)
+{
+    if (oledm.xfers) hal_fb_dump(tag);
+    if (lcdm.xfers) {
+        char t[2][17]; lcd_text(t);
+        fprintf(stderr, "[hal %s] lcd |%s|\n[hal %s] lcd |%s|\n", tag, t[0], tag, t[1]);
+    }
+    for (int p = 0; p < 2; p++) for (int sm = 0; sm < 4; sm++) {
+        strip_t *s = &strips[p][sm];
+        if (!s->words) continue;
+        if (now_us >= s->busy_until + WS_RESET_US) ws_latch(s);
+        fprintf(stderr, "[hal %s] pio%d.sm%d GP%d:", tag, p, sm, s->pin);
+        for (int i = 0; i < s->frame_n && i < 16; i++) fprintf(stderr, " %06x", s->frame[i] >> 8);
+        fprintf(stderr, "%s\n", s->frame_n > 16 ? " …" : "");
+    }
+}
+
+// ─────────── Script & run control ──────────────────────────────────────────
+static struct timespec wall0;
+
+static void ev_gpio(void *a) { uintptr_t v = (uintptr_t)a; gpio_drive_pin(v >> 8, (int8_t)(v & 1)); }
+static void ev_adc(void *a)  { uintptr_t v = (uintptr_t)a; adc_val[(v >> 16) % 5] = (uint16_t)v; }
+static void ev_noise(void *a){ uintptr_t v = (uintptr_t)a; adc_noise[(v >> 16) % 5] = (uint16_t)v; }
+static void ev_dump(void *a) { dump_all((const char *)a); }
+static void ev_key(void *a)
+{
+    stdin_put(a, strlen(a));
+}
+static void ev_end(void *a)  { (void)a; exit(0); }
+
+static void load_script(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) { fprintf(stderr, "hal: %s: %s\n", path, strerror(errno)); exit(2); }
+    char line[256], cmd[32], tag[64];
+    while (fgets(line, sizeof line, f)) {
+        double ms; unsigned a, b;
+        if (line[0] == '#' || sscanf(line, "%lf %31s", &ms, cmd) != 2) continue;
+        uint64_t t = (uint64_t)(ms * 1000);
+        if (!strcmp(cmd, "gpio") && sscanf(line, "%*f %*s %u %u", &a, &b) == 2)
+            hal_at(t, ev_gpio, (void *)(uintptr_t)(a << 8 | (b & 1)));
+        else if (!strcmp(cmd, "press") && sscanf(line, "%*f %*s %u %u", &a, &b) == 2) {
+            hal_at(t, ev_gpio, (void *)(uintptr_t)(a << 8 | 0));
+            hal_at(t + 1000ull * b, ev_gpio, (void *)(uintptr_t)(a << 8 | 1));
+        }
+        else if (!strcmp(cmd, "bounce") && sscanf(line, "%*f %*s %u %u", &a, &b) == 2) {
+            // contact chatter: 3 short glitches after each edge
+            for (int k = 0; k < 2; k++) {
+                uint64_t e = t + k * 1000ull * b;
+                for (int g = 0; g < 3; g++) {
+                    hal_at(e + 300 * g, ev_gpio, (void *)(uintptr_t)(a << 8 | (k ^ 0)));
+                    hal_at(e + 300 * g + 150, ev_gpio, (void *)(uintptr_t)(a << 8 | (k ^ 1)));
+                }
+                hal_at(e + 900, ev_gpio, (void *)(uintptr_t)(a << 8 | k));
+            }
+        }
+        else if (!strcmp(cmd, "adc") && sscanf(line, "%*f %*s %u %u", &a, &b) == 2)
+            hal_at(t, ev_adc, (void *)(uintptr_t)(a << 16 | (b & 0xFFF)));
+        else if (!strcmp(cmd, "noise") && sscanf(line, "%*f %*s %u %u", &a, &b) == 2)
+            hal_at(t, ev_noise, (void *)(uintptr_t)(a << 16 | (b & 0xFFF)));
+        else if (!strcmp(cmd, "i2c") && sscanf(line, "%*f %*s %u %63s", &a, tag) == 2 && !strcmp(tag, "hang"))
+            hal_at(t, ev_i2c, (void *)(uintptr_t)((a & 1) << 24 | 0x800000));
+        else if (!strcmp(cmd, "i2c") && sscanf(line, "%*f %*s %u nak %u", &a, &b) == 2) {
+            unsigned skip = 0;
+            sscanf(line, "%*f %*s %*u nak %*u after %u", &skip);
+            hal_at(t, ev_i2c, (void *)(uintptr_t)((a & 1) << 24 | (skip & 0x7F) << 16 | (b & 0xFFFF)));
+        }
+        else if (!strcmp(cmd, "dump") && sscanf(line, "%*f %*s %63s", tag) == 1)
+            hal_at(t, ev_dump, strdup(tag));
+        else if (!strcmp(cmd, "key") && sscanf(line, "%*f %*s %63s", tag) == 1)
+            hal_at(t, ev_key, strdup(tag));
+        else if (!strcmp(cmd, "end"))
+            hal_at(t, ev_end, NULL);
+        else fprintf(stderr, "hal: bad script line: %s", line);
+    }
+    fclose(f);
+}
+
+static void le(FILE *f, uint32_t v, int n) { for (int i = 0; i < n; i++) fputc(v >> 8*i & 0xFF, f); }
+static void wav_write(void)
+{
+    char path[512];
+    snprintf(path, sizeof path, "%s/%s_audio.wav", out_dir(), program_invocation_short_name);
+    FILE *f = fopen(path, "wb");
+    if (!f) { fprintf(stderr, "hal: %s: %s\n", path, strerror(errno)); return; }
+    fwrite("RIFF", 1, 4, f); le(f, 36 + (uint32_t)wav_n, 4); fwrite("WAVEfmt ", 1, 8, f);
+    le(f, 16, 4); le(f, 1, 2); le(f, 1, 2); le(f, wav_hz, 4); le(f, wav_hz, 4); le(f, 1, 2); le(f, 8, 2);
+    fwrite("data", 1, 4, f); le(f, (uint32_t)wav_n, 4);
+    fwrite(wav, 1, wav_n, f);
+    fclose(f);
+    fprintf(stderr, "[hal] audio: %zu samples at %u Hz (%.3f s) -> %s\n",
+            wav_n, wav_hz, (double)wav_n / wav_hz, path);
+}
+
+static void report(void)
+{
+    struct timespec w; clock_gettime(CLOCK_MONOTONIC, &w);
+    double wall = (w.tv_sec - wall0.tv_sec) + (w.tv_nsec - wall0.tv_nsec) / 1e9;
+    fflush(stdout);
+    dump_all("final");
+    fprintf(stderr, "[hal] virtual %.3f s, wall %.3f s (%.0fx)\n",
+            now_us / 1e6, wall, wall > 0 ? now_us / 1e6 / wall : 0.0);
+    if (oledm.xfers)
+        fprintf(stderr, "[hal] ssd1306: %u bytes in %u xfers, %u GDDRAM bytes\n",
+                oledm.bytes, oledm.xfers, oledm.data_bytes);
+    if (lcdm.xfers)
+        fprintf(stderr, "[hal] hd44780: %u bytes in %u xfers, %u instr, %u chars, %u clears, %u too fast\n",
+                lcdm.bytes, lcdm.xfers, lcdm.instr, lcdm.chars, lcdm.clears, lcdm.too_fast);
+    for (int p = 0; p < 2; p++) for (int sm = 0; sm < 4; sm++)
+        if (strips[p][sm].words)
+            fprintf(stderr, "[hal] pio%d.sm%d GP%d: %u words, %u frames%s\n", p, sm,
+                    strips[p][sm].pin, strips[p][sm].words, strips[p][sm].frames,
+                    strips[p][sm].dark ? " (dark)" : "");
+    if (wav_n) wav_write();
+}
+
+__attribute__((constructor)) static void hal_boot(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &wall0);
+    memset(gpio_drive, -1, sizeof gpio_drive);
+    memset(lcdm.ddram, ' ', sizeof lcdm.ddram);
+    const char *s = getenv("HAL_SCRIPT");
+    if (s && *s) load_script(s);
+    const char *in = getenv("HAL_STDIN");
+    if (in && *in) load_stdin(in);
+    const char *seed = getenv("HAL_SEED");
+    if (seed && strtoul(seed, NULL, 0)) rand_state = (uint32_t)strtoul(seed, NULL, 0);
+    const char *lim = getenv("HAL_LIMIT_MS");
+    hal_at(1000ull * (lim ? strtoull(lim, NULL, 10) : 60000), ev_end, NULL);
+    atexit(report);
+}
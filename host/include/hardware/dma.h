@@ -0,0 +1,2 @@
+// host build: see pico_host.h
+#include "pico_host.h"
@@ -0,0 +1,249 @@
+// -----------------------------------------------------------------------------
+// pico_host.h  – Pico SDK subset for the Linux host build (see host/hal.c)
+//   • every SDK header the games include maps onto this one file
+//   • time is virtual: it only moves when the game sleeps, polls or waits,
+//     and I²C / PIO / DMA traffic advances it by its modelled bus time
+// -----------------------------------------------------------------------------
+#ifndef PICO_HOST_H
+#define PICO_HOST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+typedef unsigned int uint;
+typedef uint64_t     absolute_time_t;
+
+// ─────────── board ──────────────────────────────────────────────────────────
+#ifndef PICO_DEFAULT_I2C
+#define PICO_DEFAULT_I2C          0
+#endif
+#ifndef PICO_DEFAULT_I2C_SDA_PIN
+#define PICO_DEFAULT_I2C_SDA_PIN  4
+#endif
+#ifndef PICO_DEFAULT_I2C_SCL_PIN
+#define PICO_DEFAULT_I2C_SCL_PIN  5
+#endif
+#ifndef i2c_default
+#define i2c_default               i2c0
+#endif
+
+#define __not_in_flash_func(f)    f
+#define __time_critical_func(f)   f
+#define bi_decl(x)
+#define bi_2pins_with_func(a,b,f) 0
+
+// ─────────── stdio / time ───────────────────────────────────────────────────
+bool     stdio_init_all(void);
+int      getchar_timeout_us(uint32_t timeout_us);  // $HAL_STDIN, then `key` lines
+uint32_t get_rand_32(void);                         // pico/rand.h; $HAL_SEED
+uint32_t time_us_32(void);
+uint64_t time_us_64(void);
+void     sleep_us(uint64_t us);
+void     sleep_ms(uint32_t ms);
+void     sleep_until(absolute_time_t t);
+void     tight_loop_contents(void);
+void     __wfi(void);
+void     __wfe(void);
+void     __sev(void);
+void     __dmb(void);
+
+static inline absolute_time_t get_absolute_time(void) { return time_us_64(); }
+static inline uint32_t to_ms_since_boot(absolute_time_t t) { return (uint32_t)(t / 1000); }
+static inline uint64_t to_us_since_boot(absolute_time_t t) { return t; }
+static inline absolute_time_t from_us_since_boot(uint64_t us) { return us; }
+static inline absolute_time_t delayed_by_us(absolute_time_t t, uint64_t us) { return t + us; }
+static inline absolute_time_t delayed_by_ms(absolute_time_t t, uint32_t ms) { return t + 1000ull*ms; }
+static inline absolute_time_t make_timeout_time_us(uint64_t us) { return time_us_64() + us; }
+static inline absolute_time_t make_timeout_time_ms(uint32_t ms) { return time_us_64() + 1000ull*ms; }
+static inline int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to)
+{ return (int64_t)(to - from); }
+
+// ─────────── SysTick (reads back the virtual clock in 125 MHz cycles) ──────
+typedef struct { volatile uint32_t csr, rvr, cvr, calib; } systick_hw_t;
+extern systick_hw_t host_systick;
+#define systick_hw (&host_systick)
+
+// ─────────── alarms ─────────────────────────────────────────────────────────
+typedef int32_t alarm_id_t;
+typedef int64_t (*alarm_callback_t)(alarm_id_t id, void *user_data);
+alarm_id_t add_alarm_at(absolute_time_t t, alarm_callback_t cb, void *user_data, bool fire_if_past);
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t cb, void *user_data, bool fire_if_past);
+alarm_id_t add_alarm_in_ms(uint32_t ms, alarm_callback_t cb, void *user_data, bool fire_if_past);
+bool       cancel_alarm(alarm_id_t id);
+
+// ─────────── interrupts ─────────────────────────────────────────────────────
+typedef void (*irq_handler_t)(void);
+enum { TIMER_IRQ_0, TIMER_IRQ_1, TIMER_IRQ_2, TIMER_IRQ_3, PWM_IRQ_WRAP = 4,
+       IO_IRQ_BANK0 = 13, DMA_IRQ_0 = 11, DMA_IRQ_1 = 12, ADC_IRQ_FIFO = 22,
+       I2C0_IRQ = 23, I2C1_IRQ = 24, HOST_NUM_IRQS = 32 };
+void     irq_set_exclusive_handler(uint num, irq_handler_t h);
+void     irq_set_enabled(uint num, bool on);
+uint32_t save_and_disable_interrupts(void);
+void     restore_interrupts(uint32_t status);
+typedef volatile uint32_t spin_lock_t;          // cores are cooperative: IRQ mask only
+int          spin_lock_claim_unused(bool required);
+spin_lock_t *spin_lock_init(uint lock_num);
+static inline uint32_t spin_lock_blocking(spin_lock_t *l) { (void)l; return save_and_disable_interrupts(); }
+static inline void spin_unlock(spin_lock_t *l, uint32_t s) { (void)l; restore_interrupts(s); }
+
+// ─────────── GPIO ───────────────────────────────────────────────────────────
+enum gpio_function { GPIO_FUNC_SPI = 1, GPIO_FUNC_UART = 2, GPIO_FUNC_I2C = 3,
+                     GPIO_FUNC_PWM = 4, GPIO_FUNC_SIO = 5, GPIO_FUNC_PIO0 = 6,
+                     GPIO_FUNC_PIO1 = 7, GPIO_FUNC_NULL = 0x1f };
+#define GPIO_IN  false
+#define GPIO_OUT true
+void gpio_init(uint pin);
+void gpio_set_dir(uint pin, bool out);
+void gpio_pull_up(uint pin);
+void gpio_pull_down(uint pin);
+void gpio_set_function(uint pin, enum gpio_function fn);
+bool gpio_get(uint pin);
+void gpio_put(uint pin, bool value);
+enum gpio_irq_level { GPIO_IRQ_LEVEL_LOW = 1, GPIO_IRQ_LEVEL_HIGH = 2,
+                      GPIO_IRQ_EDGE_FALL = 4, GPIO_IRQ_EDGE_RISE = 8 };
+typedef void (*gpio_irq_callback_t)(uint gpio, uint32_t event_mask);
+void gpio_set_irq_enabled(uint pin, uint32_t events, bool enabled);
+void gpio_set_irq_enabled_with_callback(uint pin, uint32_t events, bool enabled,
+                                        gpio_irq_callback_t cb);
+
+// ─────────── ADC ────────────────────────────────────────────────────────────
+void     adc_init(void);
+void     adc_gpio_init(uint pin);
+void     adc_select_input(uint ch);
+uint16_t adc_read(void);
+// free-running: one conversion every max(96, div+1) cycles of the 48 MHz ADC
+// clock, cycling through the round-robin inputs, with FIFO → DMA on DREQ_ADC
+typedef struct { volatile uint32_t cs, result, fcs, fifo, div; } adc_hw_t;
+extern adc_hw_t host_adc;
+#define adc_hw   (&host_adc)
+#define DREQ_ADC 36
+void adc_set_round_robin(uint input_mask);
+void adc_set_clkdiv(float div);
+void adc_fifo_setup(bool en, bool dreq_en, uint16_t dreq_thresh, bool err_in_fifo, bool byte_shift);
+void adc_fifo_drain(void);
+void adc_run(bool run);
+
+// ─────────── I²C ────────────────────────────────────────────────────────────
+// raw_intr_stat: TX_ABRT and STOP_DET, the interrupt when unmasked in
+// intr_mask; the clr_ reads do not clear (each DMA stream starts clean)
+typedef struct { volatile uint32_t enable, tar, data_cmd, intr_mask, raw_intr_stat,
+                 clr_stop_det, clr_tx_abrt, status, tx_abrt_source; } i2c_hw_t;
+typedef struct i2c_inst { i2c_hw_t *hw; uint idx; uint baud; } i2c_inst_t;
+extern i2c_inst_t i2c0_inst, i2c1_inst;
+#define i2c0 (&i2c0_inst)
+#define i2c1 (&i2c1_inst)
+#define I2C_IC_DATA_CMD_STOP_BITS                     0x00000200u
+#define I2C_IC_DATA_CMD_RESTART_BITS                  0x00000400u
+#define I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS             0x00000040u
+#define I2C_IC_RAW_INTR_STAT_STOP_DET_BITS            0x00000200u
+#define I2C_IC_INTR_MASK_M_TX_ABRT_BITS               0x00000040u
+#define I2C_IC_INTR_MASK_M_STOP_DET_BITS              0x00000200u
+#define I2C_IC_STATUS_TFE_BITS                        0x00000004u
+#define I2C_IC_STATUS_MST_ACTIVITY_BITS               0x00000020u
+#define I2C_IC_TX_ABRT_SOURCE_ABRT_7B_ADDR_NOACK_BITS 0x00000001u
+#define PICO_ERROR_GENERIC  -1
+#define PICO_ERROR_TIMEOUT  -2
+uint i2c_init(i2c_inst_t *i2c, uint baud);
+uint i2c_set_baudrate(i2c_inst_t *i2c, uint baud);
+int  i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src,
+                        size_t len, bool nostop);
+int  i2c_write_timeout_us(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src,
+                          size_t len, bool nostop, uint timeout_us);
+static inline i2c_hw_t *i2c_get_hw(i2c_inst_t *i2c) { return i2c->hw; }
+static inline uint i2c_get_dreq(i2c_inst_t *i2c, bool is_tx)
+{ return 32 + 2*i2c->idx + (is_tx ? 0 : 1); }
+
+// ─────────── DMA ────────────────────────────────────────────────────────────
+enum dma_channel_transfer_size { DMA_SIZE_8 = 0, DMA_SIZE_16 = 1, DMA_SIZE_32 = 2 };
+typedef struct { uint size; bool rd_inc, wr_inc; uint dreq, chain_to, ring_bits; bool ring_wr; } dma_channel_config;
+int  dma_claim_unused_channel(bool required);
+dma_channel_config dma_channel_get_default_config(uint ch);
+static inline void channel_config_set_transfer_data_size(dma_channel_config *c,
+                                                         enum dma_channel_transfer_size s)
+{ c->size = s; }
+static inline void channel_config_set_read_increment(dma_channel_config *c, bool on)  { c->rd_inc = on; }
+static inline void channel_config_set_write_increment(dma_channel_config *c, bool on) { c->wr_inc = on; }
+static inline void channel_config_set_dreq(dma_channel_config *c, uint dreq)          { c->dreq = dreq; }
+static inline void channel_config_set_chain_to(dma_channel_config *c, uint ch)        { c->chain_to = ch; }
+static inline void channel_config_set_ring(dma_channel_config *c, bool write, uint size_bits)
+{ c->ring_wr = write; c->ring_bits = size_bits; }
+void dma_channel_configure(uint ch, const dma_channel_config *c, volatile void *write_addr,
+                           const volatile void *read_addr, uint count, bool trigger);
+void dma_channel_transfer_from_buffer_now(uint ch, const volatile void *read_addr, uint count);
+void dma_channel_set_read_addr(uint ch, const volatile void *read_addr, bool trigger);
+void dma_channel_start(uint ch);
+void dma_channel_set_trans_count(uint ch, uint count, bool trigger);
+void dma_start_channel_mask(uint32_t mask);
+bool dma_channel_is_busy(uint ch);
+void dma_channel_wait_for_finish_blocking(uint ch);
+void dma_channel_abort(uint ch);
+void dma_channel_set_irq0_enabled(uint ch, bool on);
+void dma_channel_acknowledge_irq0(uint ch);
+bool dma_channel_get_irq0_status(uint ch);
+// pacing timers: a transfer every num/den clk_sys cycles
+int  dma_claim_unused_timer(bool required);
+void dma_timer_set_fraction(uint timer, uint16_t num, uint16_t den);
+static inline uint dma_get_timer_dreq(uint timer) { return 0x3b + timer; }
+
+// ─────────── PWM (level writes to a slice's CC end up in the audio WAV) ─────
+typedef struct { volatile uint32_t csr, div, ctr, cc, top; } pwm_slice_hw_t;
+typedef struct { pwm_slice_hw_t slice[8]; } pwm_hw_t;
+extern pwm_hw_t host_pwm;
+#define pwm_hw (&host_pwm)
+enum { PWM_CHAN_A = 0, PWM_CHAN_B = 1 };
+typedef struct { uint32_t csr, div, top; } pwm_config;
+static inline uint pwm_gpio_to_slice_num(uint gpio) { return (gpio >> 1) & 7; }
+static inline uint pwm_gpio_to_channel(uint gpio)   { return gpio & 1; }
+static inline pwm_config pwm_get_default_config(void) { pwm_config c = { 0, 1 << 4, 0xFFFF }; return c; }
+static inline void pwm_config_set_clkdiv(pwm_config *c, float div)  { c->div = (uint32_t)(div * 16); }
+static inline void pwm_config_set_wrap(pwm_config *c, uint16_t wrap) { c->top = wrap; }
+void pwm_init(uint slice, pwm_config *c, bool start);
+
+// ─────────── PIO ────────────────────────────────────────────────────────────
+typedef struct { volatile uint32_t txf[4]; } pio_hw_t;
+typedef pio_hw_t *PIO;
+extern pio_hw_t pio0_hw, pio1_hw;
+#define pio0 (&pio0_hw)
+#define pio1 (&pio1_hw)
+typedef struct { const uint16_t *instructions; uint8_t length; int8_t origin; } pio_program_t;
+typedef struct { float clkdiv; uint out_shift_bits, sideset_base, sideset_bits; } pio_sm_config;
+enum pio_fifo_join { PIO_FIFO_JOIN_NONE = 0, PIO_FIFO_JOIN_TX = 1, PIO_FIFO_JOIN_RX = 2 };
+uint pio_add_program(PIO pio, const pio_program_t *prog);
+int  pio_claim_unused_sm(PIO pio, bool required);
+void pio_gpio_init(PIO pio, uint pin);
+void pio_sm_init(PIO pio, uint sm, uint offset, const pio_sm_config *c);
+void pio_sm_set_enabled(PIO pio, uint sm, bool on);
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out);
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data);
+static inline uint pio_get_dreq(PIO pio, uint sm, bool is_tx)
+{ return (pio == pio1 ? 8 : 0) + (is_tx ? 0 : 4) + sm; }
+static inline pio_sm_config pio_get_default_sm_config(void) { pio_sm_config c = {1.f, 32, 0, 0}; return c; }
+static inline void sm_config_set_out_shift(pio_sm_config *c, bool right, bool autopull, uint bits)
+{ (void)right; (void)autopull; c->out_shift_bits = bits; }
+static inline void sm_config_set_fifo_join(pio_sm_config *c, enum pio_fifo_join j) { (void)c; (void)j; }
+static inline void sm_config_set_clkdiv(pio_sm_config *c, float div) { c->clkdiv = div; }
+static inline void sm_config_set_set_pins(pio_sm_config *c, uint base, uint n) { (void)c; (void)base; (void)n; }
+static inline void sm_config_set_sideset_pins(pio_sm_config *c, uint base) { c->sideset_base = base; }
+static inline void sm_config_set_wrap(pio_sm_config *c, uint w, uint t) { (void)c; (void)w; (void)t; }
+static inline void sm_config_set_sideset(pio_sm_config *c, uint b, bool o, bool p) { c->sideset_bits = b - o; (void)p; }
+
+// ─────────── clocks ─────────────────────────────────────────────────────────
+enum clock_index { clk_gpout0, clk_gpout1, clk_gpout2, clk_gpout3, clk_ref, clk_sys,
+                   clk_peri, clk_usb, clk_adc, clk_rtc };
+uint32_t clock_get_hz(enum clock_index clk);
+
+// ─────────── multicore ──────────────────────────────────────────────────────
+void     multicore_launch_core1(void (*entry)(void));
+void     multicore_fifo_push_blocking(uint32_t v);
+uint32_t multicore_fifo_pop_blocking(void);
+bool     multicore_fifo_rvalid(void);
+bool     multicore_fifo_wready(void);
+uint     get_core_num(void);
+
+// ─────────── host-only hooks (hal.c) ────────────────────────────────────────
+void hal_fb_dump(const char *tag);           // write the SSD1306 GDDRAM as PBM
+
+#endif
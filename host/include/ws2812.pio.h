@@ -0,0 +1,25 @@
+// host build: stand-in for the header pioasm generates from ws2812.pio
+#include "pico_host.h"
+
+#define ws2812_wrap_target 0
+#define ws2812_wrap 3
+#define ws2812_T1 2
+#define ws2812_T2 5
+#define ws2812_T3 3
+
+static const uint16_t ws2812_program_instructions[] = {
+    0x6221, 0x1123, 0x1400, 0xa442,
+};
+
+static const pio_program_t ws2812_program = {
+    .instructions = ws2812_program_instructions,
+    .length = 4,
+    .origin = -1,
+};
+
+static inline pio_sm_config ws2812_program_get_default_config(uint offset) {
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + ws2812_wrap_target, offset + ws2812_wrap);
+    sm_config_set_sideset(&c, 1, false, false);
+    return c;
+}
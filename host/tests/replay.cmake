@@ -0,0 +1,45 @@
+# -----------------------------------------------------------------------------
+# replay.cmake  – record a host run, replay its dump, compare the frames
+#   cmake -DGAME=<binary> -DSCRIPT=<record script> -DPLAY=<replay script>
+#         -DOUT=<dir> -P replay.cmake
+#   The record script types 'r' so the game prints its #replay dump; the
+#   replay run gets that log as $HAL_STDIN. Every PBM the recording wrote
+#   must come out byte for byte the same.
+# -----------------------------------------------------------------------------
+file(REMOVE_RECURSE ${OUT})
+file(MAKE_DIRECTORY ${OUT}/rec ${OUT}/play)
+
+execute_process(COMMAND ${CMAKE_COMMAND} -E env HAL_SEED=1 HAL_SCRIPT=${SCRIPT} HAL_OUT=${OUT}/rec
+                        ${GAME}
+                OUTPUT_FILE ${OUT}/rec.log ERROR_FILE ${OUT}/rec.err RESULT_VARIABLE rc)
+file(STRINGS ${OUT}/rec.log dump REGEX "^#replay")
+if(rc OR NOT dump)
+    message(FATAL_ERROR "record: exit ${rc}, no #replay dump in ${OUT}/rec.log")
+endif()
+
+execute_process(COMMAND ${CMAKE_COMMAND} -E env HAL_SEED=2 HAL_SCRIPT=${PLAY} HAL_OUT=${OUT}/play
+                        HAL_STDIN=${OUT}/rec.log ${GAME}
+                OUTPUT_FILE ${OUT}/play.log ERROR_FILE ${OUT}/play.err RESULT_VARIABLE rc)
+file(STRINGS ${OUT}/play.log played REGEX "^replay: ")
+if(rc OR NOT played)
+    message(FATAL_ERROR "replay: exit ${rc}, dump not played back, see ${OUT}/play.log")
+endif()
+
+file(STRINGS ${OUT}/rec.err faults REGEX "^hal: ")
+file(STRINGS ${OUT}/play.err play_faults REGEX "^hal: ")
+if(faults OR play_faults)
+    message(FATAL_ERROR "${faults}${play_faults}")
+endif()
+
+file(GLOB frames RELATIVE ${OUT}/rec ${OUT}/rec/*.pbm)
+if(NOT frames)
+    message(FATAL_ERROR "record: no frames in ${OUT}/rec")
+endif()
+foreach(f ${frames})
+    execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${OUT}/rec/${f} ${OUT}/play/${f}
+                    RESULT_VARIABLE diff)
+    if(diff)
+        message(FATAL_ERROR "replay: ${f} differs from the recording")
+    endif()
+endforeach()
+message(STATUS "${dump}: ${played}, ${frames} identical")
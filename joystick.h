@@ -0,0 +1,112 @@
+// -----------------------------------------------------------------------------
+// joystick.h  – free-running ADC joystick sampler shared by Doom and rgb
+//   • the ADC converts its inputs round-robin at JOY_RATE_HZ total; two
+//     chained DMA channels take turns writing the results into a small
+//     aligned ring, so it wraps forever and sampling costs no CPU at all
+//   • joy_axis() is a non-blocking read of the latest state: the mean of
+//     every sample of that input in the ring (JOY_RING / inputs of them,
+//     the last few ms), relative to a running center, with a dead-zone it
+//     ramps up from
+//   • the center follows the stick while it rests inside the dead-zone, so
+//     slow drift is calibrated out; joy_recenter() snaps it to "now"
+//   • joy_axis() is an input function for replay.h: recorded, or replayed
+// -----------------------------------------------------------------------------
+#ifndef JOYSTICK_H
+#define JOYSTICK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/stdlib.h"
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "replay.h"
+
+#ifndef JOY_RATE_HZ
+#define JOY_RATE_HZ   4000                    // conversions/s over all inputs
+#endif
+#define JOY_RING      32                      // samples, power of two
+#define JOY_RING_BITS 6                       // log2(JOY_RING * 2 bytes)
+#ifndef JOY_DEADZONE
+#define JOY_DEADZONE  48                      // raw counts around center
+#endif
+#define JOY_CENTER_K  6                       // center follows by 1/64 a read
+#define JOY_INPUTS    4                       // ADC0..3 (GP26..29)
+#define JOY_DMA_LEG   (JOY_RING << 16)        // transfers per channel turn, whole laps
+
+static uint16_t joy_ring[JOY_RING] __attribute__((aligned(JOY_RING * 2)));
+static uint8_t  joy_mask, joy_n, joy_first;
+static int32_t  joy_center[JOY_INPUTS];       // raw << JOY_CENTER_K
+
+// `mask`: ADC inputs to sample, bit n = ADCn. Their count must divide
+// JOY_RING (1, 2 or 4) so each ring slot always holds the same input.
+static inline void joy_init(uint8_t mask)
+{
+    adc_init();
+    joy_mask = mask & ((1u << JOY_INPUTS) - 1);
+    joy_n = 0;
+    for (int ch=0; ch<JOY_INPUTS; ch++) {
+        if (!(joy_mask & (1u << ch))) continue;
+        if (!joy_n++) joy_first = ch;
+        adc_gpio_init(26 + ch);
+        joy_center[ch] = 2048 << JOY_CENTER_K;
+    }
+    if (!joy_n || JOY_RING % joy_n) return;
+    for (int i=0; i<JOY_RING; i++) joy_ring[i] = 2048;    // calm until filled
+
+    adc_select_input(joy_first);              // the ring starts at this input
+    adc_set_round_robin(joy_n > 1 ? joy_mask : 0);
+    adc_fifo_setup(true, true, 1, false, false);
+    adc_set_clkdiv(48000000.f / JOY_RATE_HZ - 1);
+
+    // Each channel runs JOY_DMA_LEG transfers (9 min at 4 kHz), then triggers
+    // the other, which reloads its count. A leg is whole laps of the ring,
+    // so the next one picks up at slot 0 and the slots keep their inputs.
+    int ch[2] = { dma_claim_unused_channel(true), dma_claim_unused_channel(true) };
+    for (int i=0; i<2; i++) {
+        dma_channel_config c = dma_channel_get_default_config(ch[i]);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+        channel_config_set_read_increment(&c, false);
+        channel_config_set_write_increment(&c, true);
+        channel_config_set_ring(&c, true, JOY_RING_BITS);
+        channel_config_set_dreq(&c, DREQ_ADC);
+        channel_config_set_chain_to(&c, ch[i ^ 1]);
+        dma_channel_configure(ch[i], &c, joy_ring, &adc_hw->fifo, JOY_DMA_LEG, false);
+    }
+    dma_channel_start(ch[0]);
+    adc_run(true);
+}
+
+// Mean of the ring's samples of ADC input `ch`, 0..4095.
+static inline int joy_raw(uint ch)
+{
+    int k = 0;
+    for (uint m = joy_mask & ((1u << ch) - 1); m; m &= m - 1) k++;   // slot of ch
+    uint32_t sum = 0;
+    for (int i=k; i<JOY_RING; i+=joy_n)
+        sum += joy_ring[i];
+    return (int)(sum / (JOY_RING / joy_n));
+}
+
+// Stick position on input `ch`, about ±2048 at full throw: 0 inside the
+// dead-zone, then rising from 0 at its edge, stretched to keep the range.
+static inline int joy_axis(uint ch)
+{
+    int raw = joy_raw(ch);
+    int d = raw - (joy_center[ch] >> JOY_CENTER_K);
+    if (d > -JOY_DEADZONE && d < JOY_DEADZONE) {
+        joy_center[ch] += raw - (joy_center[ch] >> JOY_CENTER_K);     // rest: track drift
+        d = 0;
+    } else {
+        d = (d > 0 ? d - JOY_DEADZONE : d + JOY_DEADZONE) * 2048 / (2048 - JOY_DEADZONE);
+    }
+    return replay_input(REPLAY_JOY(ch), d);
+}
+
+// Take the current position of every input as its center.
+static inline void joy_recenter(void)
+{
+    for (int ch=0; ch<JOY_INPUTS; ch++)
+        if (joy_mask & (1u << ch)) joy_center[ch] = joy_raw(ch) << JOY_CENTER_K;
+}
+
+#endif
@@ -0,0 +1,277 @@
+// -----------------------------------------------------------------------------
+// replay.h  – deterministic input recording and replay for all three games
+//   • replay_rand(): xorshift32 seeded once at boot from get_rand_32(); the
+//     seed is recorded, so a replay draws the same enemies, wires and notes
+//   • the games' input functions pass every reading through replay_input():
+//     while recording, a changed value is appended to a RAM buffer; while
+//     replaying, the same call returns the recorded value instead
+//   • GPIO edge IRQs go through replay_gpio_irq(): logged the same way, and
+//     raised from a timer alarm at their recorded time on replay
+//   • 'r' on the stdio console (or replay_dump()) prints the buffer as hex;
+//     that dump, typed on the console within REPLAY_WAIT_MS of boot, is
+//     played back (the host shim types it from $HAL_STDIN). The wait is 0
+//     unless the build sets it, so a board boots without one
+//   • both modes leave replay_init() at the same µs after boot, so on the
+//     host a replay runs the same virtual µs as its recording, frame for
+//     frame, as fast as the CPU allows
+//   • build with REPLAY_ENABLE=0 to read inputs directly
+//
+//   header   'R' 'P' REPLAY_VERSION, seed (4 bytes, little-endian)
+//   record   delta   varint, µs since the previous record (the first: since
+//                    replay_init() returned); 7 bits a byte, low first
+//            source  byte: REPLAY_JOY(ch) stick axis, REPLAY_PIN(n) GPIO
+//                    level, REPLAY_IRQ(n) GPIO edge IRQ
+//            value   varint: axes zig-zag signed, IRQs the event mask
+// -----------------------------------------------------------------------------
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/rand.h"
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+
+#ifndef REPLAY_ENABLE
+#define REPLAY_ENABLE   1
+#endif
+#ifndef REPLAY_LEN
+#define REPLAY_LEN      32768                 // bytes; recording stops when full
+#endif
+#ifndef REPLAY_WAIT_MS
+#define REPLAY_WAIT_MS  0                     // after boot, to type a dump in
+#endif
+#define REPLAY_VERSION  1
+#define REPLAY_JOY(ch)  (0x00 | (ch))
+#define REPLAY_PIN(n)   (0x40 | (n))
+#define REPLAY_IRQ(n)   (0x80 | (n))
+
+static uint32_t replay_seed, replay_state = 1;     // PRNG state, never 0
+
+static inline uint32_t replay_rand(void)
+{
+    uint32_t x = replay_state;
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    return replay_state = x;
+}
+static inline void replay_srand(uint32_t seed)
+{
+    replay_seed = seed;
+    replay_state = seed ? seed : 1;
+}
+
+#if REPLAY_ENABLE
+#define REPLAY_KEY      'r'                   // console key that dumps the buffer
+
+enum { REPLAY_OFF, REPLAY_REC, REPLAY_PLAY };
+static uint8_t  replay_buf[REPLAY_LEN];
+static uint32_t replay_len;                   // bytes recorded / loaded
+static uint32_t replay_pos;                   // playing: next source byte
+static uint32_t replay_lost;                  // records that did not fit
+static uint8_t  replay_mode;
+static uint64_t replay_t;                     // time of the last record, µs
+static uint64_t replay_next_t;                // playing: time of the next one
+static int32_t  replay_val[256];              // latest value per source
+static uint8_t  replay_seen[256];
+static gpio_irq_callback_t replay_gpio_cb;
+
+static inline uint64_t replay_varint(const uint8_t **p)
+{
+    uint64_t v = 0;
+    for (int sh = 0; sh < 64; sh += 7) {
+        uint8_t b = *(*p)++;
+        v |= (uint64_t)(b & 0x7F) << sh;
+        if (!(b & 0x80)) break;
+    }
+    return v;
+}
+static inline uint8_t *replay_put_varint(uint8_t *p, uint64_t v)
+{
+    for (; v >= 0x80; v >>= 7) *p++ = (uint8_t)(v | 0x80);
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static void replay_put(uint64_t t, uint8_t src, uint32_t v)
+{
+    uint8_t rec[16], *p = rec;
+    uint32_t irq = save_and_disable_interrupts();  // IRQs and alarms record too
+    p = replay_put_varint(p, t - replay_t);
+    *p++ = src;
+    p = replay_put_varint(p, v);
+    uint32_t n = (uint32_t)(p - rec);
+    if (replay_lost || replay_len + n > REPLAY_LEN) replay_lost++;
+    else { memcpy(replay_buf + replay_len, rec, n); replay_len += n; replay_t = t; }
+    restore_interrupts(irq);
+}
+
+// Playing: the time of the record at replay_pos, or the end of the replay.
+static void replay_peek(void)
+{
+    if (replay_pos >= replay_len) { replay_mode = REPLAY_OFF; return; }
+    const uint8_t *p = replay_buf + replay_pos;
+    replay_next_t = replay_t + replay_varint(&p);
+    replay_pos = (uint32_t)(p - replay_buf);
+}
+
+// Set an alarm for the next IRQ record; values wait for their reads. Only
+// replay_init() and replay_fire() call it, so one alarm is out at a time.
+static int64_t replay_fire(alarm_id_t id, void *user);
+static void replay_arm(void)
+{
+    const uint8_t *p = replay_buf + replay_pos, *end = replay_buf + replay_len;
+    uint64_t t = replay_next_t;
+    while (p < end) {
+        uint8_t src = *p++;
+        replay_varint(&p);
+        if (src & 0x80) { add_alarm_at(from_us_since_boot(t), replay_fire, NULL, true); return; }
+        if (p >= end) return;
+        t += replay_varint(&p);
+    }
+}
+
+// Playing: apply the records that are due by `now`, in order. IRQ records
+// are raised only from the alarm (`irqs`), where the live edges came from;
+// a read in thread context stops at one and leaves it to the alarm.
+static void replay_advance(uint64_t now, bool irqs)
+{
+    uint32_t irq = save_and_disable_interrupts();
+    while (replay_mode == REPLAY_PLAY && replay_next_t <= now) {
+        const uint8_t *p = replay_buf + replay_pos;
+        uint8_t src = *p++;
+        if ((src & 0x80) && !irqs) break;
+        uint32_t v = (uint32_t)replay_varint(&p);
+        replay_t = replay_next_t;
+        replay_pos = (uint32_t)(p - replay_buf);
+        replay_peek();
+        if (src & 0x80) {
+            restore_interrupts(irq);
+            if (replay_gpio_cb) replay_gpio_cb(src & 0x3F, v);
+            irq = save_and_disable_interrupts();
+        } else {
+            replay_val[src] = src < 0x40 ? (int32_t)(v >> 1) ^ -(int32_t)(v & 1) : (int32_t)v;
+        }
+    }
+    restore_interrupts(irq);
+}
+static int64_t replay_fire(alarm_id_t id, void *user)
+{
+    (void)id; (void)user;
+    replay_advance(time_us_64(), true);
+    if (replay_mode == REPLAY_PLAY) replay_arm();
+    return 0;
+}
+
+// Every input reading goes through here. The clock is read in every mode, so
+// a replay spends exactly the time its recording did.
+static inline int32_t replay_input(uint8_t src, int32_t live)
+{
+    uint64_t now = time_us_64();
+    if (replay_mode == REPLAY_PLAY) {
+        replay_advance(now, false);
+        return replay_val[src];
+    }
+    if (replay_mode == REPLAY_REC && (!replay_seen[src] || replay_val[src] != live)) {
+        replay_seen[src] = 1; replay_val[src] = live;
+        replay_put(now, src, src < 0x40 ? ((uint32_t)live << 1) ^ (uint32_t)(live >> 31)
+                                        : (uint32_t)live);
+    }
+    return live;
+}
+static inline bool replay_gpio_get(uint pin)
+{ return replay_input(REPLAY_PIN(pin), gpio_get(pin)) != 0; }
+
+// Live edges only count while not replaying; the recording raises them then.
+static void replay_gpio_irq(uint gpio, uint32_t events)
+{
+    uint64_t now = time_us_64();
+    if (replay_mode == REPLAY_PLAY) return;
+    if (replay_mode == REPLAY_REC) replay_put(now, REPLAY_IRQ(gpio), events);
+    if (replay_gpio_cb) replay_gpio_cb(gpio, events);
+}
+static inline void replay_gpio_set_irq_enabled_with_callback(uint pin, uint32_t events, bool on,
+                                                             gpio_irq_callback_t cb)
+{
+    replay_gpio_cb = cb;
+    gpio_set_irq_enabled_with_callback(pin, events, on, replay_gpio_irq);
+}
+
+// Hex lines, like the trace, so it survives the console; the same text
+// typed back at boot is a replay.
+static void replay_dump(void)
+{
+    uint32_t n = replay_len;
+    printf("#replay %d bytes=%lu lost=%lu\n", REPLAY_VERSION, (unsigned long)n,
+           (unsigned long)replay_lost);
+    for (uint32_t i=0; i<n; i++) printf("%02x%s", replay_buf[i], i%32 == 31 || i == n-1 ? "\n" : "");
+    printf("#end\n");
+}
+
+static int replay_hex(int c)
+{
+    return c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10
+         : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+}
+
+// Call right after stdio_init_all(), before the first input is read. Reads
+// a dump from the console until REPLAY_WAIT_MS after boot; with a good one
+// it plays it back, otherwise it records. Either way it returns at t0, and
+// with no wait it records at once.
+static void replay_init(void)
+{
+    const uint64_t t0 = REPLAY_WAIT_MS * 1000ull + 100;
+    char line[80];
+    int n = 0;
+    bool in = false, got = false;
+    uint32_t len = 0;
+    uint64_t now;
+    while ((now = time_us_64()) < t0 - 100) {
+        int c = getchar_timeout_us((uint32_t)(t0 - now));
+        if (c < 0) continue;
+        if (c != '\n' && c != '\r') { if (n < (int)sizeof line - 1) line[n++] = (char)c; continue; }
+        line[n] = 0; n = 0;
+        if (!strncmp(line, "#replay", 7)) { in = true; got = false; len = 0; }
+        else if (in && !strcmp(line, "#end")) { in = false; got = true; }
+        else if (in) {
+            for (char *s = line; s[0] && s[1] && len < REPLAY_LEN; s += 2) {
+                int hi = replay_hex(s[0]), lo = replay_hex(s[1]);
+                if (hi < 0 || lo < 0) break;
+                replay_buf[len++] = (uint8_t)(hi << 4 | lo);
+            }
+        }
+    }
+    uint32_t seed = get_rand_32();
+    sleep_until(from_us_since_boot(t0));            // however the reading ended
+    replay_t = t0;
+    if (got && len >= 7 && replay_buf[0] == 'R' && replay_buf[1] == 'P'
+        && replay_buf[2] == REPLAY_VERSION) {
+        replay_srand(replay_buf[3] | replay_buf[4] << 8 | replay_buf[5] << 16
+                     | (uint32_t)replay_buf[6] << 24);
+        replay_len = len; replay_pos = 7; replay_mode = REPLAY_PLAY;
+        printf("replay: %lu B, seed %08lx\n", (unsigned long)len, (unsigned long)replay_seed);
+        replay_peek();
+        replay_arm();
+        return;
+    }
+    if (in) printf("replay: dump still coming at %d ms, recording\n", REPLAY_WAIT_MS);
+    else if (got) printf("replay: not a version %d replay, recording\n", REPLAY_VERSION);
+    replay_srand(seed);
+    replay_buf[0] = 'R'; replay_buf[1] = 'P'; replay_buf[2] = REPLAY_VERSION;
+    for (int i=0; i<4; i++) replay_buf[3+i] = (uint8_t)(replay_seed >> 8*i);
+    replay_len = 7; replay_mode = REPLAY_REC;
+    printf("record: seed %08lx, 'r' dumps\n", (unsigned long)replay_seed);
+}
+#else
+static inline void replay_init(void) { replay_srand(get_rand_32()); }
+static inline int32_t replay_input(uint8_t src, int32_t live) { (void)src; return live; }
+static inline bool replay_gpio_get(uint pin) { return gpio_get(pin); }
+static inline void replay_gpio_set_irq_enabled_with_callback(uint pin, uint32_t events, bool on,
+                                                             gpio_irq_callback_t cb)
+{ gpio_set_irq_enabled_with_callback(pin, events, on, cb); }
+static inline void replay_dump(void) { }
+#endif
+
+#endif
@@ -9,21 +9,36 @@
 #include "hardware/adc.h"
 #include "hardware/i2c.h"
 #include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/sync.h"
 #include "hardware/clocks.h"
 
-#include "ssd1306_font.h"    // your SSD1306 text helpers
+#include "ssd1306.h"         // shared SSD1306 transport
+#include "ssd1306_text.h"    // 8x8 font blitter
+#include "replay.h"          // input recording, 'r' on USB dumps it
+#include "trace.h"           // frame profiling, 't' on USB dumps it
+#include "joystick.h"        // DMA-fed, filtered ADC stick
 #include "ws2812.pio.h"      // generated by CMake
 
 // ─────────────── Configurable ────────────────────────────────────────────────
-#define LED_PIN       0       // WS2812 data pin (GP0)
-#define NUM_LEDS      8
+#define LED_PIN       0       // WS2812 data pin (GP0); strip i is on LED_PIN+i
+#define NUM_LEDS      8       // LEDs in the ring, drawn on every strip
+#ifndef LED_BENCH
+#define LED_BENCH     0       // 1: LED frame-rate benchmark instead of the game
+#endif
+#ifndef NUM_STRIPS
+#define NUM_STRIPS    (LED_BENCH ? 8 : 1)   // one SM + DMA channel each, ≤ 8
+#endif
+#define LED_MAX       (LED_BENCH ? 300 : NUM_LEDS)  // LEDs a strip can hold
 #define WS2812_FREQ   800000  // 800 kHz
 
 #define JOY_ADC_CH    0       // VRx → ADC0 (GP26)
 #define JOY_THRESHOLD 200     // ADC dead-zone around center
 #define CURSOR_STEP_MS 120    // repeat delay when holding stick
+#define JOY_SAMPLE_MS  20     // stick sampling period (timer)
 
 #define BUTTON_PIN   14       // “Cut” button on GP14
+#define CUT_DEBOUNCE_US 5000  // still low this long after the edge = a press
 
 #define OLED_WIDTH   128
 #define OLED_HEIGHT   64
@@ -44,10 +59,10 @@ static inline void ws2812_program_init_wrap(PIO pio, uint sm, uint offset, uint
     int cycles = ws2812_T1 + ws2812_T2 + ws2812_T3;  // from generated header
     sm_config_set_clkdiv(&c, clock_hz / (WS2812_FREQ * cycles));
 
-    // init pin and state machine
+    // the program drives its pin by side-set: mux it to the PIO, make it a PIO output
     pio_gpio_init(pio, pin);
-    gpio_set_dir(pin, GPIO_OUT);
-    sm_config_set_set_pins(&c, pin, 1);
+    pio_sm_set_consecutive_pindirs(pio, sm, pin, 1, true);
+    sm_config_set_sideset_pins(&c, pin);
     pio_sm_init(pio, sm, offset, &c);
     pio_sm_set_enabled(pio, sm, true);
 }
@@ -57,7 +72,105 @@ static inline uint32_t ws_color(uint8_t r, uint8_t g, uint8_t b){
     return ((uint32_t)g<<24) | ((uint32_t)r<<16) | ((uint32_t)b<<8);
 }
 
-static void ring_show(PIO pio, uint sm, int cursor, int target_color){
+// ─────────────── LED frames → DMA → PIO ─────────────────────────────────────
+// The game draws into each strip's buf and calls led_commit(). Strips whose
+// frame equals the one last sent are skipped; the rest get their DMA
+// channel (paced by their SM's DREQ) and all start in the same cycle, so
+// the strips clock out in parallel and a frame takes as long as the longest
+// strip, however many there are. One alarm fires once its last bit and the
+// ≥50 µs reset gap are out. A commit during that time waits in `next` and
+// goes from the alarm, so the CPU never waits on the LEDs.
+#define LED_WORD_US   30                              // 24 bits at 800 kHz
+#define LED_RESET_US  60                              // latch: line low ≥ 50 µs
+_Static_assert(NUM_STRIPS >= 1 && NUM_STRIPS <= 8, "two PIOs, four SMs each");
+
+typedef struct {
+    PIO      pio;
+    uint     sm;
+    int      dma;
+    int      n;                                       // LEDs in use
+    bool     pending;                                 // `next` waits to go out
+    uint32_t buf[LED_MAX];                            // drawn by the game
+    uint32_t next[LED_MAX];                           // committed while busy
+    uint32_t sent[LED_MAX];                           // DMA source / on the LEDs
+} led_strip_t;
+
+static led_strip_t strips[NUM_STRIPS];
+static volatile bool led_busy;
+
+static int64_t led_latched(alarm_id_t id, void *user);
+
+// Send every strip whose frame changed; from_next: the parked commits.
+static void led_start(bool from_next){
+    uint32_t mask = 0;
+    int longest = 0;
+    for (int i = 0; i < NUM_STRIPS; ++i) {
+        led_strip_t *st = &strips[i];
+        const uint32_t *src = from_next ? st->next : st->buf;
+        if (from_next && !st->pending) continue;
+        st->pending = false;
+        if (!st->n || !memcmp(src, st->sent, st->n * sizeof st->sent[0])) continue;
+        memcpy(st->sent, src, st->n * sizeof st->sent[0]);
+        dma_channel_set_read_addr(st->dma, st->sent, false);
+        dma_channel_set_trans_count(st->dma, st->n, false);
+        mask |= 1u << st->dma;
+        if (st->n > longest) longest = st->n;
+        trace_add(TC_PIO_WORDS, st->n);
+    }
+    if (!mask) return;
+    led_busy = true;
+    dma_start_channel_mask(mask);
+    add_alarm_in_us(longest * LED_WORD_US + LED_RESET_US, led_latched, NULL, true);
+}
+
+static int64_t led_latched(alarm_id_t id, void *user){
+    (void)id; (void)user;
+    led_busy = false;
+    led_start(true);
+    return 0;
+}
+
+static void led_commit(void){
+    uint32_t irq = save_and_disable_interrupts();
+    if (led_busy) {
+        for (int i = 0; i < NUM_STRIPS; ++i) {
+            memcpy(strips[i].next, strips[i].buf, sizeof strips[i].next);
+            strips[i].pending = true;
+        }
+    } else {
+        led_start(false);
+    }
+    restore_interrupts(irq);
+}
+
+static void led_init(void){
+    uint offset[2];
+    for (int i = 0; i < NUM_STRIPS; ++i) {
+        led_strip_t *st = &strips[i];
+        st->pio = i < 4 ? pio0 : pio1;
+        if (i % 4 == 0) offset[i / 4] = pio_add_program(st->pio, &ws2812_program);
+        st->sm  = pio_claim_unused_sm(st->pio, true);
+        st->n   = NUM_LEDS;
+        ws2812_program_init_wrap(st->pio, st->sm, offset[i / 4], LED_PIN + i);
+
+        st->dma = dma_claim_unused_channel(true);
+        dma_channel_config c = dma_channel_get_default_config(st->dma);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+        channel_config_set_read_increment(&c, true);
+        channel_config_set_write_increment(&c, false);
+        channel_config_set_dreq(&c, pio_get_dreq(st->pio, st->sm, true));
+        dma_channel_configure(st->dma, &c, &st->pio->txf[st->sm], st->sent, st->n, false);
+        // sent starts all-zero, which is what a freshly powered strip shows
+    }
+}
+
+static void led_fill(uint32_t col){
+    for (int i = 0; i < NUM_STRIPS; ++i)
+        for (int j = 0; j < strips[i].n; ++j) strips[i].buf[j] = col;
+    led_commit();
+}
+
+static void ring_show(int cursor, int target_color){
     const uint32_t off_col = ws_color(4,4,4);
     static const uint32_t on_cols[3] = {
         [0] = 0x00FF0000,  // green
@@ -65,46 +178,47 @@ static void ring_show(PIO pio, uint sm, int cursor, int target_color){
         [2] = 0x000000FF   // red
     };
     uint32_t on_col = on_cols[target_color];
+    TRACE_SCOPE(TR_LEDS);
 
-    for(int i = 0; i < NUM_LEDS; ++i){
-        pio_sm_put_blocking(pio, sm, i == cursor ? on_col : off_col);
+    for(int s = 0; s < NUM_STRIPS; ++s){
+        for(int i = 0; i < strips[s].n; ++i){
+            strips[s].buf[i] = i % NUM_LEDS == cursor ? on_col : off_col;
+        }
     }
+    led_commit();
 }
 
 // ─────────────── OLED Helpers ────────────────────────────────────────────────
 #define FB_SIZE (OLED_WIDTH * OLED_HEIGHT / 8)
 static uint8_t fb[FB_SIZE];
 
-static void oled_cmd(uint8_t c){
-    uint8_t buf[2] = {0x80, c};
-    i2c_write_blocking(OLED_I2C_BUS, OLED_ADDR, buf, 2, false);
-}
+static ssd1306_t oled = { .bus = OLED_I2C_BUS, .addr = OLED_ADDR };
+static uint8_t fb_dirty;     // bit p → page p touched since last refresh
+static uint32_t oled_frames, oled_rep_bytes, oled_rep_xfers;   // since the last report
 
-static void oled_data(const uint8_t *d, size_t n){
-    uint8_t chunk[17] = {0x40};
-    while(n){
-        size_t m = n > 16 ? 16 : n;
-        memcpy(chunk+1, d, m);
-        i2c_write_blocking(OLED_I2C_BUS, OLED_ADDR, chunk, m+1, false);
-        d += m; n -= m;
-    }
-}
-
-static inline void fb_px(int x, int y, bool on){
-    if((u_int)x>=OLED_WIDTH||(u_int)y>=OLED_HEIGHT) return;
-    uint32_t idx = (y>>3)*OLED_WIDTH + x;
-    uint8_t mask = 1u << (y & 7);
-    fb[idx] = on ? (fb[idx] | mask) : (fb[idx] & ~mask);
+static void oled_refresh(void){
+    TRACE_SCOPE(TR_PRESENT);
+    uint32_t bytes0 = oled.bytes, xfers0 = oled.xfers;
+    ssd1306_flush(&oled, fb, fb_dirty);
+    fb_dirty = 0;
+    oled_frames++;
+    trace_add(TC_I2C_BYTES, oled.bytes - bytes0);
+    trace_add(TC_I2C_XFERS, oled.xfers - xfers0);
 }
 
-static void oled_refresh(void){
-    const uint8_t cfg[] = {0x21,0,OLED_WIDTH-1,0x22,0,OLED_HEIGHT/8-1};
-    for(int i=0;i<6;i++) oled_cmd(cfg[i]);
-    oled_data(fb, FB_SIZE);
+// Bytes and transactions per refresh since the last call; quiet if none.
+static void oled_report(void){
+    if (!oled_frames) return;
+    printf("oled: %lu B/frame in %lu xfers (%lu frames)\n",
+           (unsigned long)((oled.bytes - oled_rep_bytes) / oled_frames),
+           (unsigned long)((oled.xfers - oled_rep_xfers) / oled_frames),
+           (unsigned long)oled_frames);
+    oled_rep_bytes = oled.bytes; oled_rep_xfers = oled.xfers; oled_frames = 0;
 }
 
 static void oled_clear(void){
     memset(fb,0,FB_SIZE);
+    fb_dirty = 0xFF;
     oled_refresh();
 }
 
@@ -118,62 +232,138 @@ static void oled_init(void){
     gpio_set_function(OLED_SDA_PIN, GPIO_FUNC_I2C);
     gpio_set_function(OLED_SCL_PIN, GPIO_FUNC_I2C);
     gpio_pull_up(OLED_SDA_PIN); gpio_pull_up(OLED_SCL_PIN);
-    for(size_t i=0;i<sizeof(init_seq);++i) oled_cmd(init_seq[i]);
+    ssd1306_cmds(&oled, init_seq, sizeof init_seq);
+    oled_rep_bytes = oled.bytes; oled_rep_xfers = oled.xfers;   // frames only
     oled_clear();
 }
 
-// text helpers from ssd1306_font.h
-static int glyph_index(char c){
-    if(c>='A'&&c<='Z') return 1+(c-'A');
-    if(c>='a'&&c<='z') return 1+(c-'a');
-    if(c>='0'&&c<='9') return 27+(c-'0');
-    if(c=='!') return 37;
-    if(c=='-') return 38;
-    return 0;
-}
-static void draw_char(int x,int y,char c){
-    const uint8_t *f = &font[glyph_index(c)*8];
-    for(int cx=0;cx<8;++cx)
-        for(int cy=0;cy<8;++cy)
-            fb_px(x+cx,y+cy, (f[cx]&(1u<<cy)) );
-}
+// text helpers from ssd1306_text.h
 static void draw_str(int x,int y,const char *s){
-    for(;*s;++s, x+=8) draw_char(x,y,*s);
+    fb_dirty |= ssd1306_text(fb, x, y, s);
+    trace_add(TC_PIXELS, 64*strlen(s));
 }
 static void draw_center(int y,const char *s){
     int w = strlen(s)*8;
     draw_str((OLED_WIDTH-w)/2, y, s);
 }
 
-// ─────────────── Helpers ─────────────────────────────────────────────────────
+// ─────────────── Events ──────────────────────────────────────────────────────
+// Nothing polls. A repeating alarm samples the stick every JOY_SAMPLE_MS and
+// the cut button's falling edge raises a GPIO IRQ; both only set flags, and
+// the main loop sleeps in __wfi() until one is set.
+static volatile int  joy_dir;
+static volatile bool joy_ready, cut_fired;
+
 static int read_joystick(){
-    adc_select_input(JOY_ADC_CH);
-    int raw = adc_read() - 2048;
+    TRACE_SCOPE(TR_INPUT);
+    int raw = joy_axis(JOY_ADC_CH);          // filtered, from the DMA ring
     if (raw >  JOY_THRESHOLD) return +1;
     if (raw < -JOY_THRESHOLD) return -1;
     return 0;
 }
 
+static int64_t joy_sample(alarm_id_t id, void *user){
+    (void)id; (void)user;
+    int dir = read_joystick();
+    // centred: this alarm still wakes the core, the loop just has nothing to do
+    if (dir || dir != joy_dir) joy_ready = true;
+    joy_dir = dir;
+    return JOY_SAMPLE_MS * 1000;
+}
+
+// The edge turns the IRQ off, so chatter and a held button cannot re-enter
+// the cut; it counts if the pin still reads low CUT_DEBOUNCE_US later, and
+// a glitch re-arms it.
+static int64_t cut_settle(alarm_id_t id, void *user){
+    (void)id; (void)user;
+    if (!replay_gpio_get(BUTTON_PIN)) cut_fired = true;
+    else gpio_set_irq_enabled(BUTTON_PIN, GPIO_IRQ_EDGE_FALL, true);
+    return 0;
+}
+
+static void cut_irq(uint gpio, uint32_t events){
+    (void)gpio; (void)events;
+    gpio_set_irq_enabled(BUTTON_PIN, GPIO_IRQ_EDGE_FALL, false);
+    add_alarm_in_us(CUT_DEBOUNCE_US, cut_settle, NULL, true);
+}
+
+// ─────────────── Duty cycle ──────────────────────────────────────────────────
+// Time awake against time in __wfi(), and wakeups, printed once a second
+// (on the next wakeup after it).
+static uint64_t duty_t0, duty_idle_us;
+static uint32_t duty_wakes;
+
+static void wait_for_event(void){
+    uint64_t t0 = time_us_64();
+    uint32_t irq = save_and_disable_interrupts();
+    if (!joy_ready && !cut_fired) __wfi();           // a pending IRQ still wakes it
+    restore_interrupts(irq);                         // handlers run here
+    uint64_t t1 = time_us_64();
+    trace_span(TR_WAIT, t0);
+    duty_idle_us += t1 - t0;
+    duty_wakes++;
+    if (t1 - duty_t0 >= 1000000) {
+        uint64_t span = t1 - duty_t0;                  // integer maths: no soft-float here
+        uint32_t busy_pm = (uint32_t)((span - duty_idle_us) * 1000 / span);
+        uint32_t wakes = (uint32_t)((duty_wakes * 1000000ull + span / 2) / span);
+        printf("cpu: %lu.%lu%% busy, %lu wakeups/s\n", (unsigned long)(busy_pm / 10),
+               (unsigned long)(busy_pm % 10), (unsigned long)wakes);
+        oled_report();
+        duty_t0 = t1; duty_idle_us = 0; duty_wakes = 0;
+    }
+}
+
+#if LED_BENCH
+// ─────────────── LED benchmark ───────────────────────────────────────────────
+// Frame rate against LEDs per strip and number of strips. Every LED changes
+// every frame, so each frame is sent in full; `serial` is the same LEDs on
+// one strip.
+#define BENCH_FRAMES 50
+static void led_bench(void){
+    static const int counts[] = { 8, 30, 60, 144, 300 };
+    printf("strips  leds/strip  leds  frame_us   fps  serial_fps\n");
+    for (int k = 1; k <= NUM_STRIPS; k *= 2) {
+        for (size_t c = 0; c < sizeof counts / sizeof counts[0]; ++c) {
+            for (int i = 0; i < NUM_STRIPS; ++i) strips[i].n = i < k ? counts[c] : 0;
+            absolute_time_t t0 = get_absolute_time();
+            for (int f = 0; f < BENCH_FRAMES; ++f) {
+                for (int i = 0; i < k; ++i)
+                    for (int j = 0; j < counts[c]; ++j) strips[i].buf[j] = ws_color(f, j, i);
+                led_commit();
+                while (led_busy) __wfi();
+            }
+            int64_t us = absolute_time_diff_us(t0, get_absolute_time()) / BENCH_FRAMES;
+            int serial_us = k * counts[c] * LED_WORD_US + LED_RESET_US;
+            printf("%6d  %10d  %4d  %8lld  %4lld  %10d\n", k, counts[c], k * counts[c],
+                   (long long)us, (long long)(1000000 / us), 1000000 / serial_us);
+        }
+    }
+    printf("bench done\n");
+}
+#endif
+
 // ─────────────── Main ────────────────────────────────────────────────────────
 int main(){
     stdio_init_all();
     sleep_ms(100);
+    replay_init();                           // record, or replay a typed-in dump
 
     // init peripherals
     oled_init();
     gpio_init(BUTTON_PIN); gpio_set_dir(BUTTON_PIN, GPIO_IN); gpio_pull_up(BUTTON_PIN);
-    adc_init(); adc_gpio_init(26);
+    joy_init(1u << JOY_ADC_CH);
+    trace_init();
 
     // init PIO+WS2812
-    PIO pio = pio0;
-    uint offset = pio_add_program(pio, &ws2812_program);
-    uint sm     = pio_claim_unused_sm(pio, true);
-    ws2812_program_init_wrap(pio, sm, offset, LED_PIN);
+    led_init();
+#if LED_BENCH
+    led_bench();
+    while (1) sleep_ms(1000);
+#endif
 
     // pick random target
-    srand((uint32_t)time_us_32());
-    int8_t color = rand() % 3;
-    int8_t target = rand() % NUM_LEDS;
+    int8_t color = replay_rand() % 3;
+    int8_t target = replay_rand() % NUM_LEDS;
     static const char *names[3] = {"GREEN","BLUE","RED"};
 
     // title screen
@@ -186,22 +376,33 @@ int main(){
     // cursor control
     int cursor = 0;
     absolute_time_t next_move = get_absolute_time();
+    ring_show(cursor, color);
+
+    alarm_id_t joy_alarm = add_alarm_in_ms(JOY_SAMPLE_MS, joy_sample, NULL, true);
+    replay_gpio_set_irq_enabled_with_callback(BUTTON_PIN, GPIO_IRQ_EDGE_FALL, true, cut_irq);
+    duty_t0 = time_us_64();
 
     while (1) {
+        wait_for_event();
+
         // step cursor if held
-        int dir = read_joystick();
-        if (absolute_time_diff_us(next_move, get_absolute_time()) < 0) {
-            if (dir) {
+        if (joy_ready) {
+            joy_ready = false;
+            int dir = joy_dir;
+            absolute_time_t now = get_absolute_time();
+            if (!dir) {
+                next_move = now;                     // released: next push moves at once
+            } else if (absolute_time_diff_us(next_move, now) >= 0) {
                 cursor = (cursor + dir + NUM_LEDS) % NUM_LEDS;
-                next_move = delayed_by_ms(get_absolute_time(), CURSOR_STEP_MS);
+                next_move = delayed_by_ms(now, CURSOR_STEP_MS);
+                ring_show(cursor, color);
             }
         }
 
-        // update ring
-        ring_show(pio, sm, cursor, color);
-
-        // handle cut button
-        if (!gpio_get(BUTTON_PIN)) {
+        // handle cut button (once: its IRQ stays off)
+        if (cut_fired) {
+            cut_fired = false;
+            cancel_alarm(joy_alarm);                 // game over, stop sampling
             bool success = (cursor == target);
             uint8_t code = (color<<4) | cursor;
 
@@ -210,22 +411,23 @@ int main(){
                 uint32_t c = success
                     ? ws_color(0,80,0)
                     : ws_color(80,0,0);
-                for(int j=0;j<NUM_LEDS;++j) pio_sm_put_blocking(pio, sm, c);
+                led_fill(c);
                 sleep_ms(80);
-                for(int j=0;j<NUM_LEDS;++j) pio_sm_put_blocking(pio, sm, 0);
+                led_fill(0);
                 sleep_ms(80);
             }
+            ring_show(cursor, color);
 
             // result screen
             oled_clear();
             draw_center((OLED_HEIGHT/2)-4, success ? "DEFUSED!" : "BOOM!");
             oled_refresh();
+            oled_report();                           // no more wakeups to print it
 
             printf("wire_code=0x%02X\n", code);
-            tight_loop_contents();
         }
 
-        tight_loop_contents();
+        trace_frame();
     }
 
     return 0;
@@ -0,0 +1,124 @@
+// -----------------------------------------------------------------------------
+// ssd1306.h  – shared SSD1306 128×64 I²C transport for Doom and rgb_wire_cut
+//   • one I²C transaction per command list  (control 0x00, Co=0 → all cmds)
+//   • one I²C transaction per frame / span  (control 0x40, Co=0 → all data)
+//   • shadow of the panel RAM + dirty-page delta flush
+//   • byte / transaction counters for measuring bus time
+//   • optional write hook, so a game can put retries/recovery under it
+// -----------------------------------------------------------------------------
+#ifndef SSD1306_DRIVER_H
+#define SSD1306_DRIVER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "hardware/i2c.h"
+
+#define SSD1306_W        128
+#define SSD1306_H         64
+#define SSD1306_PAGES    (SSD1306_H / 8)
+#define SSD1306_FB_LEN   (SSD1306_W * SSD1306_H / 8)
+
+#define SSD1306_CTRL_CMD  0x00     // Co=0 D/C#=0 : rest of transaction = commands
+#define SSD1306_CTRL_DATA 0x40     // Co=0 D/C#=1 : rest of transaction = GDDRAM
+#define SSD1306_SPAN_GAP  12       // merge spans closer than a re-address costs
+
+typedef struct ssd1306 ssd1306_t;
+typedef bool (*ssd1306_write_fn)(i2c_inst_t *bus, uint8_t addr,
+                                 const uint8_t *b, size_t n);
+
+struct ssd1306 {
+    i2c_inst_t *bus;
+    uint8_t     addr;
+    ssd1306_write_fn write;                   // NULL → i2c_write_blocking
+    uint32_t    bytes;                        // bytes on the bus incl. address
+    uint32_t    xfers;                        // START … STOP transactions
+    bool        shadow_ok;                    // false → panel RAM unknown
+    uint8_t     shadow[SSD1306_FB_LEN];       // what the panel already shows
+};
+
+// ─────────── Blocking transport ─────────────────────────────────────────────
+static uint8_t ssd1306_xfer_buf[1 + SSD1306_FB_LEN];
+
+// False if the transaction did not go through.
+static inline bool ssd1306_write(ssd1306_t *d, uint8_t ctl, const uint8_t *b, size_t n)
+{
+    ssd1306_xfer_buf[0] = ctl;
+    memcpy(ssd1306_xfer_buf+1, b, n);
+    d->bytes += n+2; d->xfers++;
+    if (d->write) return d->write(d->bus, d->addr, ssd1306_xfer_buf, n+1);
+    return i2c_write_blocking(d->bus, d->addr, ssd1306_xfer_buf, n+1, false) == (int)(n+1);
+}
+static inline bool ssd1306_cmds(ssd1306_t *d, const uint8_t *c, size_t n)
+{ return ssd1306_write(d, SSD1306_CTRL_CMD, c, n); }
+static inline bool ssd1306_data(ssd1306_t *d, const uint8_t *b, size_t n)
+{ return ssd1306_write(d, SSD1306_CTRL_DATA, b, n); }
+static inline bool ssd1306_window(ssd1306_t *d, int x0, int x1, int p0, int p1)
+{
+    const uint8_t a[] = {0x21,(uint8_t)x0,(uint8_t)x1,0x22,(uint8_t)p0,(uint8_t)p1};
+    return ssd1306_cmds(d, a, sizeof a);
+}
+
+// ─────────── IC_DATA_CMD word encoder (for DMA) ─────────────────────────────
+// Same transaction as ssd1306_write(), but as RP2040 I²C data_cmd words with
+// STOP on the last byte, so a DMA channel can stream several back to back.
+static inline uint16_t *ssd1306_enc(ssd1306_t *d, uint16_t *w, uint8_t ctl,
+                                    const uint8_t *b, size_t n)
+{
+    *w++ = ctl;
+    for (size_t i=0; i<n; i++) *w++ = b[i];
+    w[-1] |= I2C_IC_DATA_CMD_STOP_BITS;
+    d->bytes += n+2; d->xfers++;
+    return w;
+}
+
+// ─────────── Delta flush ────────────────────────────────────────────────────
+// Walks the pages flagged in `dirty`, calls emit() for every column span of
+// fb[] that differs from the shadow and updates the shadow. Returns false if
+// emit() refuses a span (caller's buffer is full, or the write failed) so it
+// can send a full frame.
+typedef bool (*ssd1306_emit_fn)(ssd1306_t *d, int x0, int x1, int page,
+                                const uint8_t *src);
+
+static inline bool ssd1306_delta(ssd1306_t *d, const uint8_t *fb, uint8_t dirty,
+                                 ssd1306_emit_fn emit)
+{
+    for (int p=0; p<SSD1306_PAGES; p++) {
+        if (!(dirty & (1u<<p))) continue;
+        const uint8_t *row = &fb[p*SSD1306_W]; uint8_t *old = &d->shadow[p*SSD1306_W];
+        int x=0;
+        while (x<SSD1306_W) {
+            while (x<SSD1306_W && row[x]==old[x]) x++;
+            if (x==SSD1306_W) break;
+            int x0=x, x1=x;
+            for (int gap=0; x<SSD1306_W && gap<SSD1306_SPAN_GAP; x++) {
+                if (row[x]!=old[x]) { x1=x; gap=0; } else gap++;
+            }
+            if (!emit(d, x0, x1, p, row+x0)) return false;
+            memcpy(old+x0, row+x0, x1-x0+1);
+            x = x1+1;
+        }
+    }
+    return true;
+}
+
+static inline bool ssd1306_emit_blocking(ssd1306_t *d, int x0, int x1, int page,
+                                         const uint8_t *src)
+{
+    return ssd1306_window(d, x0, x1, page, page) && ssd1306_data(d, src, x1-x0+1);
+}
+
+// Blocking refresh: full frame the first time, changed spans afterwards.
+// After a failed write the panel RAM is unknown, so the next one is full.
+static inline void ssd1306_flush(ssd1306_t *d, const uint8_t *fb, uint8_t dirty)
+{
+    if (d->shadow_ok) {
+        if (!ssd1306_delta(d, fb, dirty, ssd1306_emit_blocking)) d->shadow_ok = false;
+        return;
+    }
+    memcpy(d->shadow, fb, SSD1306_FB_LEN);
+    d->shadow_ok = ssd1306_window(d, 0, SSD1306_W-1, 0, SSD1306_PAGES-1)
+                && ssd1306_data(d, fb, SSD1306_FB_LEN);
+}
+
+#endif
@@ -0,0 +1,62 @@
+// -----------------------------------------------------------------------------
+// ssd1306_text.h  – 8×8 text straight into a page-format SSD1306 framebuffer
+//   • font_lut[]: char → glyph in ssd1306_font.h, one load instead of an
+//     if-chain (unknown chars map to the blank glyph)
+//   • glyph columns are written as page bytes: one byte op per column when
+//     y is page-aligned, a shift-merge into two pages otherwise
+//   • cells are opaque (glyph background clears), clipped at the edges
+// -----------------------------------------------------------------------------
+#ifndef SSD1306_TEXT_H
+#define SSD1306_TEXT_H
+
+#include <stdint.h>
+#include "ssd1306.h"
+#include "ssd1306_font.h"
+
+static const uint8_t font_lut[256] = {
+    ['A']= 1, ['B']= 2, ['C']= 3, ['D']= 4, ['E']= 5, ['F']= 6, ['G']= 7,
+    ['H']= 8, ['I']= 9, ['J']=10, ['K']=11, ['L']=12, ['M']=13, ['N']=14,
+    ['O']=15, ['P']=16, ['Q']=17, ['R']=18, ['S']=19, ['T']=20, ['U']=21,
+    ['V']=22, ['W']=23, ['X']=24, ['Y']=25, ['Z']=26,
+    ['a']= 1, ['b']= 2, ['c']= 3, ['d']= 4, ['e']= 5, ['f']= 6, ['g']= 7,
+    ['h']= 8, ['i']= 9, ['j']=10, ['k']=11, ['l']=12, ['m']=13, ['n']=14,
+    ['o']=15, ['p']=16, ['q']=17, ['r']=18, ['s']=19, ['t']=20, ['u']=21,
+    ['v']=22, ['w']=23, ['x']=24, ['y']=25, ['z']=26,
+    ['0']=27, ['1']=28, ['2']=29, ['3']=30, ['4']=31, ['5']=32, ['6']=33,
+    ['7']=34, ['8']=35, ['9']=36, ['!']=37, ['-']=38,
+};
+
+// Returns the page bits it touched, for the caller's dirty mask.
+static inline uint8_t ssd1306_glyph(uint8_t *fb, int x, int y, uint8_t g)
+{
+    if (x <= -8 || x >= SSD1306_W || y <= -8 || y >= SSD1306_H) return 0;
+    const uint8_t *s = &font[g*8];
+    int c0 = x < 0 ? -x : 0, c1 = x > SSD1306_W-8 ? SSD1306_W-x : 8;
+    int p = y >> 3, sh = y & 7;                   // y<0: p=-1, only p+1 shows
+    uint8_t dirty = 0;
+    if (p >= 0) {
+        uint8_t *d = &fb[p*SSD1306_W];
+        if (!sh) for (int c=c0; c<c1; c++) d[x+c] = s[c];
+        else {
+            uint8_t keep = 0xFF >> (8-sh);        // rows above the glyph
+            for (int c=c0; c<c1; c++) d[x+c] = (d[x+c] & keep) | (uint8_t)(s[c] << sh);
+        }
+        dirty |= 1u << p;
+    }
+    if (sh && p+1 < SSD1306_PAGES) {
+        uint8_t *d = &fb[(p+1)*SSD1306_W];
+        uint8_t keep = 0xFF << sh;                // rows below the glyph
+        for (int c=c0; c<c1; c++) d[x+c] = (d[x+c] & keep) | (s[c] >> (8-sh));
+        dirty |= 1u << (p+1);
+    }
+    return dirty;
+}
+
+static inline uint8_t ssd1306_text(uint8_t *fb, int x, int y, const char *s)
+{
+    uint8_t dirty = 0;
+    for (; *s; s++, x += 8) dirty |= ssd1306_glyph(fb, x, y, font_lut[(uint8_t)*s]);
+    return dirty;
+}
+
+#endif
@@ -0,0 +1,158 @@
+// -----------------------------------------------------------------------------
+// chart_compile.c  – host tool: text step chart → ddr_chart.h byte array
+//   • one row per line, lanes L U R D: '0'/'.' none, '1' tap, '2' hold
+//     start, '3' hold end (same lane)
+//   • directives on their own line, usable between any rows:
+//       title <text>    shown on the LCD (first 16 chars)
+//       bpm <n>         tempo for the rows that follow (may be fractional)
+//       div <n>         rows per beat (default 1)
+//       offset <ms>     silence before the first row (default 0)
+//   • '#' starts a comment; blank lines are ignored
+//   • times are rounded to ms once, from the start, so deltas never drift
+//
+//   cc -O2 -o chart_compile tools/chart_compile.c
+//   ./chart_compile [-n name] song.chart > song.h
+// -----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include "../ddr_chart.h"
+
+typedef struct { uint32_t t, hold; uint8_t lane; } note_t;
+
+static note_t  *notes;
+static int      n_notes, cap_notes;
+static uint8_t *out;
+static int      n_out, cap_out;
+
+static void die(const char *file, int line, const char *msg)
+{
+    fprintf(stderr, "%s:%d: %s\n", file, line, msg);
+    exit(1);
+}
+
+static void emit(uint8_t b)
+{
+    if (n_out == cap_out) out = realloc(out, cap_out = cap_out ? 2*cap_out : 256);
+    out[n_out++] = b;
+}
+
+static void emit_varint(uint32_t v)
+{
+    for (; v >= 0x80; v >>= 7) emit((uint8_t)(v | 0x80));
+    emit((uint8_t)v);
+}
+
+static int by_time(const void *a, const void *b)
+{
+    const note_t *x = a, *y = b;
+    if (x->t != y->t) return x->t < y->t ? -1 : 1;
+    if (x->hold != y->hold) return x->hold < y->hold ? -1 : 1;
+    return x->lane - y->lane;
+}
+
+int main(int argc, char **argv)
+{
+    const char *name = NULL, *path = NULL;
+    for (int i=1; i<argc; i++) {
+        if (!strcmp(argv[i], "-n") && i+1 < argc) name = argv[++i];
+        else path = argv[i];
+    }
+    if (!path) {
+        fprintf(stderr, "usage: %s [-n name] song.chart > song.h\n", argv[0]);
+        return 2;
+    }
+    FILE *f = fopen(path, "r");
+    if (!f) { perror(path); return 1; }
+
+    char title[17] = "", buf[256];
+    char cname[64];
+    if (!name) {                              // song.chart → chart_song
+        const char *b = strrchr(path, '/');
+        b = b ? b+1 : path;
+        snprintf(cname, sizeof cname, "chart_%.*s", (int)strcspn(b, "."), b);
+        for (char *c = cname; *c; c++) if (!isalnum((unsigned char)*c)) *c = '_';
+        name = cname;
+    }
+
+    double bpm = 120, t = 0;                  // ms from chart start
+    int    div = 1, line = 0;
+    int    held[4] = { -1, -1, -1, -1 };      // open hold per lane, note index
+    while (fgets(buf, sizeof buf, f)) {
+        line++;
+        buf[strcspn(buf, "#\r\n")] = 0;
+        char *s = buf;
+        while (isspace((unsigned char)*s)) s++;
+        for (char *e = s + strlen(s); e > s && isspace((unsigned char)e[-1]); ) *--e = 0;
+        if (!*s) continue;
+
+        double v;
+        if (!strncmp(s, "title", 5) && isspace((unsigned char)s[5])) {
+            for (s += 5; isspace((unsigned char)*s); s++) { }
+            snprintf(title, sizeof title, "%s", s);
+        } else if (sscanf(s, "bpm %lf", &v) == 1) {
+            if (v <= 0) die(path, line, "bpm must be positive");
+            bpm = v;
+        } else if (sscanf(s, "div %lf", &v) == 1) {
+            if (v < 1) die(path, line, "div must be at least 1");
+            div = (int)v;
+        } else if (sscanf(s, "offset %lf", &v) == 1) {
+            if (n_notes || t) die(path, line, "offset must come before the first row");
+            t = v;
+        } else if (strlen(s) == 4 && strspn(s, ".0123") == 4) {
+            uint32_t ms = (uint32_t)(t + 0.5);
+            for (int lane=0; lane<4; lane++) {
+                char c = s[lane];
+                if (c == '1' || c == '2') {
+                    if (held[lane] >= 0) die(path, line, "note inside an open hold");
+                    if (n_notes == cap_notes)
+                        notes = realloc(notes, (cap_notes = cap_notes ? 2*cap_notes : 256) * sizeof *notes);
+                    notes[n_notes] = (note_t){ ms, 0, (uint8_t)lane };
+                    if (c == '2') held[lane] = n_notes;
+                    n_notes++;
+                } else if (c == '3') {
+                    if (held[lane] < 0) die(path, line, "hold end without a start");
+                    notes[held[lane]].hold = ms - notes[held[lane]].t;
+                    held[lane] = -1;
+                }
+            }
+            t += 60000.0 / bpm / div;
+        } else {
+            die(path, line, "expected a row (4 of . 0 1 2 3) or title/bpm/div/offset");
+        }
+    }
+    fclose(f);
+    for (int lane=0; lane<4; lane++)
+        if (held[lane] >= 0) die(path, line, "hold still open at end of chart");
+
+    // Notes at the same time with the same hold share one record.
+    qsort(notes, n_notes, sizeof *notes, by_time);
+    emit('D'); emit('C'); emit(CHART_VERSION);
+    for (const char *c = title; *c; c++) emit((uint8_t)*c);
+    emit(0);
+    uint32_t prev = 0;
+    int records = 0;
+    for (int i=0; i<n_notes; ) {
+        uint8_t lanes = 0;
+        int j = i;
+        for (; j<n_notes && notes[j].t == notes[i].t && notes[j].hold == notes[i].hold; j++)
+            lanes |= 1u << notes[j].lane;
+        emit_varint(notes[i].t - prev);
+        emit(lanes | (notes[i].hold ? CHART_HOLD : 0));
+        if (notes[i].hold) emit_varint(notes[i].hold);
+        prev = notes[i].t;
+        records++;
+        i = j;
+    }
+    emit(0); emit(0);                          // end record
+
+    printf("// generated by tools/chart_compile.c from %s – do not edit\n", path);
+    printf("// \"%s\": %d notes in %d records, %d bytes, %u.%03u s\n",
+           title, n_notes, records, n_out, (unsigned)(prev/1000), (unsigned)(prev%1000));
+    printf("static const uint8_t %s[] = {", name);
+    for (int i=0; i<n_out; i++) printf("%s0x%02x,", i % 12 ? " " : "\n    ", out[i]);
+    printf("\n};\n");
+    return 0;
+}
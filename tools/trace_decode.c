@@ -0,0 +1,130 @@
+// -----------------------------------------------------------------------------
+// trace_decode.c  – host tool: turns a trace.h dump into a per-phase timeline
+//   • reads a console log (stdin or file); every #trace … #end block in it
+//     is decoded, other lines are ignored
+//   • one line per frame: each span as +offset/duration µs from frame start,
+//     then the frame's counters
+//   • summary per phase: count, avg / max µs, share of total frame time
+//
+//   cc -O2 -o trace_decode tools/trace_decode.c
+//   ./trace_decode [-s] [log]          (-s: summary only)
+// -----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MAX_IDS  32
+#define REC_HEX  24                       // 12-byte record, two digits a byte
+
+typedef struct { uint32_t t, v; uint16_t frame; uint8_t id, core; } rec_t;
+
+static char  names[MAX_IDS][32];
+static int   n_ids, n_spans;
+static rec_t *recs;
+static int   n_recs, cap_recs;
+static bool  summary_only;
+
+static uint32_t le32(const uint8_t *b) { return b[0] | b[1]<<8 | b[2]<<16 | (uint32_t)b[3]<<24; }
+
+static bool parse_rec(const char *s, rec_t *r)
+{
+    uint8_t b[REC_HEX/2];
+    for (int i=0; i<REC_HEX/2; i++) {
+        unsigned x;
+        if (sscanf(s + 2*i, "%2x", &x) != 1) return false;
+        b[i] = (uint8_t)x;
+    }
+    *r = (rec_t){ le32(b), le32(b+4), (uint16_t)(b[8] | b[9]<<8), b[10], b[11] };
+    return r->id < n_ids;
+}
+
+// Frames in ring order, records of a frame by start time; frame numbers are
+// 16-bit and may wrap inside one dump, so keep first-seen order for them.
+static int frame_rank(uint16_t f)
+{ return (uint16_t)(f - recs[0].frame); }
+static int by_frame_time(const void *a, const void *b)
+{
+    const rec_t *x = a, *y = b;
+    int fx = frame_rank(x->frame), fy = frame_rank(y->frame);
+    if (fx != fy) return fx - fy;
+    return (int32_t)(x->t - y->t) < 0 ? -1 : x->t != y->t;
+}
+
+static void decode(unsigned long lost)
+{
+    if (!n_recs) { printf("trace: empty\n"); return; }
+    qsort(recs, n_recs, sizeof *recs, by_frame_time);
+    uint64_t n[MAX_IDS] = {0}, sum[MAX_IDS] = {0}, max[MAX_IDS] = {0};
+    printf("trace: %d records (%lu lost), frames %u..%u\n",
+           n_recs, lost, recs[0].frame, recs[n_recs-1].frame);
+    if (!summary_only) printf("frame    start_ms    len_us  timeline (+offset/duration us)\n");
+    for (int i=0, j; i<n_recs; i=j) {
+        uint32_t t0 = recs[i].t, len = 0; bool whole = false;
+        for (j=i; j<n_recs && recs[j].frame==recs[i].frame; j++)
+            if (recs[j].id == 0) { t0 = recs[j].t; len = recs[j].v; whole = true; }
+        if (!summary_only) {
+            printf("%5u %11.3f ", recs[i].frame, t0/1000.0);
+            if (whole) printf("%9u ", len); else printf("%9s ", "open");
+        }
+        for (int k=i; k<j; k++) {
+            const rec_t *r = &recs[k];
+            if (r->id == 0 && !whole) continue;
+            n[r->id]++; sum[r->id] += r->v; if (r->v > max[r->id]) max[r->id] = r->v;
+        }
+        if (summary_only) continue;
+        for (int k=i; k<j; k++) {                   // spans, then counters
+            const rec_t *r = &recs[k];
+            if (r->id && r->id < n_spans)
+                printf(" %s%s %+d/%u", names[r->id], r->core ? "@1" : "",
+                       (int32_t)(r->t - t0), r->v);
+        }
+        for (int k=i; k<j; k++)
+            if (recs[k].id >= n_spans) printf(" %s=%u", names[recs[k].id], recs[k].v);
+        printf("\n");
+    }
+    uint64_t frame_us = sum[0] ? sum[0] : 1;
+    printf("\nphase           n    avg_us    max_us   %% frame\n");
+    for (int id=0; id<n_spans; id++) if (n[id])
+        printf("%-10s %6llu %9llu %9llu %8.1f\n", names[id], (unsigned long long)n[id],
+               (unsigned long long)(sum[id]/n[id]), (unsigned long long)max[id],
+               100.0 * sum[id] / frame_us);
+    printf("\ncounter         n   avg/frm   max/frm     total\n");
+    for (int id=n_spans; id<n_ids; id++) if (n[id])
+        printf("%-10s %6llu %9llu %9llu %9llu\n", names[id], (unsigned long long)n[id],
+               (unsigned long long)(sum[id]/n[id]), (unsigned long long)max[id],
+               (unsigned long long)sum[id]);
+}
+
+int main(int argc, char **argv)
+{
+    FILE *in = stdin;
+    for (int i=1; i<argc; i++) {
+        if (!strcmp(argv[i], "-s")) summary_only = true;
+        else if (!(in = fopen(argv[i], "r"))) { perror(argv[i]); return 1; }
+    }
+    char line[1024]; bool inside = false; unsigned long lost = 0; int blocks = 0;
+    while (fgets(line, sizeof line, in)) {
+        line[strcspn(line, "\r\n")] = 0;
+        unsigned long nrec; char list[900];
+        if (sscanf(line, "#trace 1 recs=%lu lost=%lu spans=%d %899s", &nrec, &lost, &n_spans, list) == 4) {
+            n_ids = 0;
+            for (char *tok = strtok(list, ","); tok && n_ids < MAX_IDS; tok = strtok(NULL, ","))
+                snprintf(names[n_ids++], sizeof names[0], "%s", tok);
+            n_recs = 0; inside = true;
+        } else if (inside && !strcmp(line, "#end")) {
+            if (blocks++) printf("\n");
+            decode(lost); inside = false;
+        } else if (inside && strlen(line) == REC_HEX) {
+            if (n_recs == cap_recs) {
+                cap_recs = cap_recs ? 2*cap_recs : 1024;
+                recs = realloc(recs, cap_recs * sizeof *recs);
+                if (!recs) { perror("realloc"); return 1; }
+            }
+            if (parse_rec(line, &recs[n_recs])) n_recs++;
+        }
+    }
+    if (!blocks) { fprintf(stderr, "trace_decode: no #trace block found\n"); return 1; }
+    return 0;
+}
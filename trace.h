@@ -0,0 +1,140 @@
+// -----------------------------------------------------------------------------
+// trace.h  – per-frame profiling probes + binary trace ring for all three games
+//   • TRACE_SCOPE(id) times the rest of the enclosing block (64-bit µs timer)
+//   • trace_add(id,n) bumps a per-frame counter (I²C bytes/xfers, pixels,
+//     PIO words); trace_frame() closes the frame and logs the non-zero ones
+//   • fixed ring of 12-byte records, oldest overwritten
+//   • 't' on the stdio console (or trace_dump()) prints the ring as hex
+//     lines; tools/trace_decode.c turns that into a per-phase timeline
+//   • build with TRACE_ENABLE=0 and every probe compiles away
+//   • trace_poll() also serves replay.h's dump key, if that came first
+// -----------------------------------------------------------------------------
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+#ifndef TRACE_ENABLE
+#define TRACE_ENABLE 1
+#endif
+#ifndef TRACE_LEN
+#define TRACE_LEN    1024                     // records, power of two
+#endif
+#define TRACE_KEY    't'                      // console key that dumps the ring
+
+// Spans first, then counters; the decoder learns the split from the dump.
+enum {
+    TR_FRAME, TR_INPUT, TR_SIM, TR_RENDER, TR_PRESENT, TR_WAIT, TR_FLUSH,
+    TR_LCD, TR_LEDS, TR_AUDIO, TR_NSPANS,
+    TC_I2C_BYTES = TR_NSPANS, TC_I2C_XFERS, TC_PIXELS, TC_PIO_WORDS, TR_NIDS
+};
+typedef struct {
+    uint32_t t;          // start, µs since boot (low 32 bits)
+    uint32_t v;          // span: duration µs · counter: per-frame total
+    uint16_t frame;
+    uint8_t  id;
+    uint8_t  core;
+} trace_rec_t;
+
+#if TRACE_ENABLE
+static const char *const trace_names[TR_NIDS] = {
+    "frame", "input", "sim", "render", "present", "wait", "flush",
+    "lcd", "leds", "audio",
+    "i2c_bytes", "i2c_xfers", "pixels", "pio_words"
+};
+static trace_rec_t   trace_ring[TRACE_LEN];
+static uint32_t      trace_head;              // records ever written
+static uint16_t      trace_fno;
+static uint64_t      trace_f0;                // start of the open frame
+static uint32_t      trace_ctr[TR_NIDS - TR_NSPANS];
+static bool          trace_off;               // paused while dumping
+static spin_lock_t  *trace_lock;              // core1 and IRQs log too
+
+static inline void trace_init(void)
+{
+    trace_lock = spin_lock_init(spin_lock_claim_unused(true));
+    trace_f0 = time_us_64();
+}
+
+static inline uint64_t trace_now(void) { return time_us_64(); }
+static inline void trace_put(uint8_t id, uint64_t t, uint32_t v)
+{
+    if (trace_off) return;
+    uint32_t irq = spin_lock_blocking(trace_lock);
+    trace_ring[trace_head++ & (TRACE_LEN-1)] =
+        (trace_rec_t){ (uint32_t)t, v, trace_fno, id, (uint8_t)get_core_num() };
+    spin_unlock(trace_lock, irq);
+}
+static inline void trace_span(uint8_t id, uint64_t t0)
+{ trace_put(id, t0, (uint32_t)(time_us_64() - t0)); }
+static inline void trace_add(uint8_t id, uint32_t n) { trace_ctr[id - TR_NSPANS] += n; }
+
+typedef struct { uint8_t id; uint64_t t0; } trace_scope_t;
+static inline void trace_scope_end(trace_scope_t *s) { trace_span(s->id, s->t0); }
+#define TRACE_CAT_(a,b) a##b
+#define TRACE_CAT(a,b)  TRACE_CAT_(a,b)
+#define TRACE_SCOPE(id) \
+    trace_scope_t TRACE_CAT(trace_scope_, __LINE__) \
+        __attribute__((cleanup(trace_scope_end))) = { (id), time_us_64() }
+
+// Oldest record first. Hex keeps the dump intact through stdio's CRLF
+// translation and whatever else shares the console.
+static void trace_dump(void)
+{
+    trace_off = true;
+    uint32_t head = trace_head, n = head < TRACE_LEN ? head : TRACE_LEN;
+    printf("#trace 1 recs=%lu lost=%lu spans=%d", (unsigned long)n,
+           (unsigned long)(head - n), TR_NSPANS);
+    for (int i=0; i<TR_NIDS; i++) printf("%c%s", i ? ',' : ' ', trace_names[i]);
+    printf("\n");
+    for (uint32_t i=head-n; i!=head; i++) {
+        const uint8_t *b = (const uint8_t *)&trace_ring[i & (TRACE_LEN-1)];
+        for (size_t k=0; k<sizeof(trace_rec_t); k++) printf("%02x", b[k]);
+        printf("\n");
+    }
+    printf("#end\n");
+    trace_off = false;
+}
+
+// Serve a dump request if the console asked for one; trace_frame() calls
+// this, idle loops outside the frame loop should too.
+static inline void trace_poll(void)
+{
+    int c = getchar_timeout_us(0);
+    if (c == TRACE_KEY) trace_dump();
+#ifdef REPLAY_KEY
+    if (c == REPLAY_KEY) replay_dump();
+#endif
+}
+
+// End of one game frame: log its span and counters and start the next one.
+static inline void trace_frame(void)
+{
+    for (int i=0; i<TR_NIDS-TR_NSPANS; i++)
+        if (trace_ctr[i]) { trace_put(TR_NSPANS+i, trace_f0, trace_ctr[i]); trace_ctr[i] = 0; }
+    uint64_t now = time_us_64();
+    trace_put(TR_FRAME, trace_f0, (uint32_t)(now - trace_f0));
+    trace_f0 = now; trace_fno++;
+    trace_poll();
+}
+#else
+static inline void trace_init(void) { }
+static inline uint64_t trace_now(void) { return 0; }
+static inline void trace_span(uint8_t id, uint64_t t0) { (void)id; (void)t0; }
+static inline void trace_add(uint8_t id, uint32_t n) { (void)id; (void)n; }
+static inline void trace_dump(void) { }
+static inline void trace_poll(void)
+{
+#ifdef REPLAY_KEY
+    if (getchar_timeout_us(0) == REPLAY_KEY) replay_dump();
+#endif
+}
+static inline void trace_frame(void) { trace_poll(); }
+#define TRACE_SCOPE(id) (void)(id)
+#endif
+
+#endif